@@ -0,0 +1,140 @@
+#include "assembler.h"
+#include "../error.h"
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+using namespace vm;
+
+Assembler::Assembler(Memory& memory) : memory(memory) {}
+
+/**
+ * Assembles a whole program. Small programs are streamed straight through the parser; larger ones are split
+ * into chunks at newline boundaries which are lexed and parsed on separate threads. Chunks are handled in
+ * batches of one per hardware thread and emitted in source order, so labels, addresses and the line numbers
+ * reported in errors are the same as for a sequential parse.
+ */
+void Assembler::assemble(std::string_view program) {
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads == 1 || program.size() <= CHUNK_SIZE) {
+    lexer::Lexer lexer(program);
+    parser::Parser parser(lexer);
+    assemble(parser);
+    return;
+  }
+
+  // split the program into chunks which each end on a line boundary, noting the line each starts on
+  std::vector<std::string_view> chunks;
+  std::vector<unsigned int> lines;
+  unsigned int line = 1;
+  for (size_t start = 0; start < program.size(); ) {
+    size_t end = program.find('\n', std::min(start + CHUNK_SIZE, program.size() - 1));
+    end = (end == std::string_view::npos) ? program.size() : end + 1;
+
+    chunks.push_back(program.substr(start, end - start));
+    lines.push_back(line);
+    line += std::count(program.begin() + start, program.begin() + end, '\n');
+    start = end;
+  }
+
+  for (size_t batch = 0; batch < chunks.size(); batch += threads) {
+    size_t count = std::min<size_t>(threads, chunks.size() - batch);
+    std::vector<std::vector<syntax::Node*>> parsed(count);
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < count; i++) {
+      workers.emplace_back([&, i]{
+        try {
+          lexer::Lexer lexer(chunks[batch + i], lines[batch + i]);
+          parser::Parser parser(lexer);
+          parsed[i] = parser.parseMultiple();
+        }
+        catch (...) { errors[i] = std::current_exception(); }
+      });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    // emit in source order, reporting the earliest error and disposing of anything left unplaced
+    for (size_t i = 0; i < count; i++) {
+      try {
+        if (errors[i]) std::rethrow_exception(errors[i]);
+        for (size_t j = 0; j < parsed[i].size(); j++) {
+          syntax::Node* node = std::exchange(parsed[i][j], nullptr);
+          emit(node);
+        }
+      }
+      catch (...) {
+        for (std::vector<syntax::Node*>& nodes : parsed)
+          for (syntax::Node* node : nodes) delete node;
+        throw;
+      }
+    }
+  }
+
+  link();
+}
+
+/**
+ * Pulls statements from the parser until the program is exhausted, emitting each into memory as soon as it
+ * is parsed, then resolves any outstanding forward branches.
+ */
+void Assembler::assemble(parser::Parser& parser) {
+  while (syntax::Node* node = parser.parseNext()) emit(node);
+  link();
+}
+
+/**
+ * Places a single parsed statement. Takes ownership of the node; instructions are handed on to memory and
+ * everything else is disposed of once it has been accounted for.
+ */
+void Assembler::emit(syntax::Node* node) {
+  std::unique_ptr<syntax::Node> owner(node);
+
+  if (syntax::DirectiveNode* directive = dynamic_cast<syntax::DirectiveNode*>(node)) {
+    if (directive->isData()) text = false;
+    else if (directive->isText()) text = true;
+    else if (directive->isGlobal()) entry_point = true;
+  }
+  else if (syntax::AllocationNode* allocation = dynamic_cast<syntax::AllocationNode*>(node)) {
+    if (text) throw AssemblyError("Cannot declare data outside of the data section.", node->statement());
+    memory.allocate(allocation);
+  }
+  else if (syntax::LabelNode* label = dynamic_cast<syntax::LabelNode*>(node)) {
+    if (!text) throw AssemblyError("Cannot declare branchable labels outside of the text section.", node->statement());
+    if (entry_point) {
+      memory.entry(memory.memstart() + (memory.size() * 32));
+      entry_point = false;
+    }
+
+    memory.addLabel(label->identifier(), memory.size());
+  }
+  else if (syntax::InstructionNode* instruction = dynamic_cast<syntax::InstructionNode*>(node)) {
+    if (!text) return;                                              // instructions outside of the text section are discarded
+
+    syntax::BranchNode* branch = dynamic_cast<syntax::BranchNode*>(instruction);
+    if (branch != nullptr && branch->toLabel()) {
+      if (memory.hasLabel(branch->label())) branch->link(memory.label(branch->label()));
+      else patches.push_back(branch);
+    }
+
+    memory.emit(instruction);
+    owner.release();
+  }
+}
+
+/**
+ * Resolves branches to labels which were declared after the branch itself.
+ */
+void Assembler::link() {
+  for (syntax::BranchNode* branch : patches) {
+    if (!memory.hasLabel(branch->label())) 
+      throw AssemblyError("Branch to undeclared label '" + std::string(lexer::name(branch->label())) + "'.", branch->statement(), 1);
+
+    branch->link(memory.label(branch->label()));
+  }
+
+  patches.clear();
+}
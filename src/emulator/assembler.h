@@ -0,0 +1,42 @@
+/**
+ * @file assembler.h
+ * Lays out a program in memory one statement at a time as it comes out of the parser, so that neither the
+ * token stream nor the full syntax tree needs to be held in memory. Branches to labels which have not yet
+ * been declared are recorded in a patch list and resolved once the whole program has been seen.
+ * Large programs are split into chunks at line boundaries which are lexed and parsed in parallel, then
+ * placed in order by a short sequential pass.
+ * @date 18/10/26
+ */
+
+#ifndef IRISC_ASSEMBLER_H
+#define IRISC_ASSEMBLER_H
+
+#include <vector>
+#include <optional>
+#include <string_view>
+#include "windows/memory.h"
+#include "../parser/parser.h"
+#include "../parser/syntax.h"
+
+namespace vm {
+
+  class Assembler {
+    private:
+      static constexpr size_t CHUNK_SIZE = 1 << 18;  // bytes of source per parallel parse job
+
+      Memory& memory;
+      bool text = true;
+      bool entry_point = false;
+      std::vector<syntax::BranchNode*> patches;       // forward branches awaiting their label address
+
+    public:
+      Assembler(Memory&);
+      void assemble(std::string_view);
+      void assemble(parser::Parser&);
+      void emit(syntax::Node*);
+      void link();
+  };
+
+}
+
+#endif //IRISC_ASSEMBLER_H
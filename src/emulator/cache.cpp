@@ -0,0 +1,285 @@
+#include "cache.h"
+#include "../parser/parser.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <string_view>
+
+using namespace vm;
+
+namespace {
+  constexpr uint64_t P1 = 11400714785074694791ULL;
+  constexpr uint64_t P2 = 14029467366897019727ULL;
+  constexpr uint64_t P3 = 1609587929392839161ULL;
+  constexpr uint64_t P4 = 9650029242287828579ULL;
+  constexpr uint64_t P5 = 2870177450012600261ULL;
+
+  uint64_t read64(const char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+  uint32_t read32(const char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+  uint64_t round(uint64_t acc, uint64_t input) { return std::rotl(acc + input * P2, 31) * P1; }
+  uint64_t merge(uint64_t acc, uint64_t val) { return (acc ^ round(0, val)) * P1 + P4; }
+
+  // fixed width binary helpers for the on-disk format
+  template <typename T> void put(std::ostream& out, T value) { out.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+  template <typename T> T get(std::istream& in) { T value{}; in.read(reinterpret_cast<char*>(&value), sizeof(T)); return value; }
+
+  void putString(std::ostream& out, std::string_view str) {
+    put<uint32_t>(out, str.size());
+    out.write(str.data(), str.size());
+  }
+
+  /**
+   * Reads a length prefixed string, refusing a length longer than what is left of the file.
+   */
+  std::string getString(std::istream& in, uint64_t size) {
+    uint32_t length = get<uint32_t>(in);
+    std::streamoff position = in.tellg();
+    if (!in || position < 0 || length > size - std::min<uint64_t>(size, position)) {
+      in.setstate(std::ios::failbit);
+      return {};
+    }
+
+    std::string str(length, '\0');
+    in.read(str.data(), str.size());
+    return str;
+  }
+
+  /**
+   * Whether a count of items, each taking at least the given number of bytes on disk, fits in what is left of
+   * the file, so that a corrupt count cannot size an allocation.
+   */
+  bool fits(std::istream& in, uint64_t size, uint64_t count, uint64_t bytes) {
+    std::streamoff position = in.tellg();
+    return in && position >= 0 && count <= (size - std::min<uint64_t>(size, position)) / bytes;
+  }
+}
+
+/**
+ * 64 bit xxHash (XXH64) of a block of text.
+ */
+uint64_t vm::hash(std::string_view data, uint64_t seed) {
+  const char* p = data.data();
+  const char* end = p + data.size();
+  uint64_t h;
+
+  if (data.size() >= 32) {
+    uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+    }
+
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+    h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+  }
+  else h = seed + P5;
+
+  h += data.size();
+  for (; p + 8 <= end; p += 8) h = std::rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+  if (p + 4 <= end) { h = std::rotl(h ^ (read32(p) * P1), 23) * P2 + P3; p += 4; }
+  for (; p < end; p++) h = std::rotl(h ^ (static_cast<uint8_t>(*p) * P5), 11) * P1;
+
+  h ^= h >> 33; h *= P2;
+  h ^= h >> 29; h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+
+Cache::Cache(size_t capacity) : capacity(capacity) {}
+
+/**
+ * Looks up an assembled program by its source text, checking memory first and then the disk if enabled.
+ * Returns nullptr if the program has not been assembled before.
+ */
+std::shared_ptr<Image> Cache::find(std::string_view source) {
+  std::lock_guard lock(mutex);
+
+  uint64_t key = hash(source);
+
+  auto it = index.find(key);
+  if (it != index.end() && it->second->length == source.size()) {
+    entries.splice(entries.begin(), entries, it->second);                   // mark as most recently used
+    return it->second->image;
+  }
+
+  std::shared_ptr<Image> image = read(key, source.size());
+  if (image) remember(key, source.size(), image);
+  return image;
+}
+
+/**
+ * Remembers a newly assembled program, writing it through to the disk if enabled.
+ */
+void Cache::insert(std::string_view source, std::shared_ptr<Image> image) {
+  std::lock_guard lock(mutex);
+  uint64_t key = hash(source);
+  if (_directory) write(key, source.size(), *image);
+  remember(key, source.size(), image);
+}
+
+/**
+ * Adds an image to the front of the in-memory tier, evicting the least recently used one if the cache is full.
+ */
+void Cache::remember(uint64_t key, size_t length, std::shared_ptr<Image> image) {
+  auto it = index.find(key);
+  if (it != index.end()) {
+    entries.erase(it->second);
+    index.erase(it);
+  }
+
+  entries.push_front({key, length, image});
+  index[key] = entries.begin();
+
+  if (entries.size() > capacity) {
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+/**
+ * Enables the on-disk tier, storing images in the given directory.
+ */
+void Cache::directory(std::string directory) {
+  std::lock_guard lock(mutex);
+  std::filesystem::create_directories(directory);
+  _directory = directory;
+}
+
+void Cache::clear() {
+  std::lock_guard lock(mutex);
+  entries.clear();
+  index.clear();
+}
+
+std::string Cache::path(uint64_t key) const {
+  std::stringstream ss;
+  ss << *_directory << "/" << std::hex << std::setfill('0') << std::setw(16) << key << ".irisc";
+  return ss.str();
+}
+
+/**
+ * Writes an image to disk. The file holds a header, the symbol table and then each instruction as its
+ * machine code word and resolved branch address followed by the tokens of its statement, from which the
+ * node is rebuilt on load without going through the lexer.
+ */
+void Cache::write(uint64_t key, size_t length, const Image& image) const {
+  std::ofstream out(path(key), std::ios::binary | std::ios::trunc);
+  if (!out) return;                                                         // the disk tier is best effort
+
+  put<uint32_t>(out, MAGIC);
+  put<uint32_t>(out, VERSION);
+  put<uint64_t>(out, key);
+  put<uint64_t>(out, length);
+  put<uint8_t>(out, image.entry.has_value());
+  put<uint32_t>(out, image.entry.value_or(0));
+
+  put<uint32_t>(out, image.labels.size());
+  for (auto const& [label, offset] : image.labels) {
+    putString(out, lexer::name(label));
+    put<uint32_t>(out, offset);
+  }
+
+  put<uint32_t>(out, image.text.size());
+  for (syntax::InstructionNode* instruction : image.text) {
+    syntax::BranchNode* branch = dynamic_cast<syntax::BranchNode*>(instruction);
+    put<uint32_t>(out, instruction->encode().word);
+    put<uint32_t>(out, branch != nullptr ? branch->address() : 0);
+
+    const std::vector<lexer::Token>& statement = instruction->statement();
+    put<uint32_t>(out, statement.size());
+    for (lexer::Token const& token : statement) {
+      put<uint32_t>(out, token.type());
+      put<uint32_t>(out, token.lineNumber());
+      put<uint32_t>(out, token.tokenNumber());
+      putString(out, token.value());
+    }
+  }
+}
+
+/**
+ * Reads an image back from disk, returning nullptr if there is no file for this program. A file which was
+ * written by a different version, or which is truncated or corrupt, is removed so that it is written again
+ * the next time the program is assembled.
+ */
+std::shared_ptr<Image> Cache::read(uint64_t key, size_t length) const {
+  if (!_directory) return nullptr;
+
+  std::string file = path(key);
+  std::ifstream in(file, std::ios::binary);
+  if (!in) return nullptr;
+
+  std::shared_ptr<Image> image;
+  try { image = decode(in, key, length, std::filesystem::file_size(file)); }
+  catch (const std::exception&) {}
+
+  if (!image) {
+    in.close();
+    std::error_code error;
+    std::filesystem::remove(file, error);
+  }
+  return image;
+}
+
+/**
+ * Rebuilds an image from a file of the given size. Every length and count is checked against what is left of
+ * the file before anything is allocated for it.
+ */
+std::shared_ptr<Image> Cache::decode(std::istream& in, uint64_t key, size_t length, uint64_t size) const {
+  if (get<uint32_t>(in) != MAGIC || get<uint32_t>(in) != VERSION) return nullptr;
+  if (get<uint64_t>(in) != key || get<uint64_t>(in) != length) return nullptr;
+
+  std::shared_ptr<Image> image = std::make_shared<Image>();
+  bool hasEntry = get<uint8_t>(in);
+  uint32_t entry = get<uint32_t>(in);
+  if (hasEntry) image->entry = entry;
+
+  uint32_t labels = get<uint32_t>(in);
+  if (!fits(in, size, labels, 8)) return nullptr;                          // a length and an offset per label
+  for (uint32_t i = 0; i < labels && in; i++) {
+    std::string name = getString(in, size);
+    uint32_t offset = get<uint32_t>(in);
+    if (!in) return nullptr;
+    image->labels.insert({lexer::intern(name), offset});
+  }
+
+  uint32_t instructions = get<uint32_t>(in);
+  if (!fits(in, size, instructions, 12)) return nullptr;                   // a word, an address and a token count each
+  image->text.reserve(instructions);
+  for (uint32_t i = 0; i < instructions && in; i++) {
+    get<uint32_t>(in);                                                      // machine code, unused by the interpreter
+    uint32_t address = get<uint32_t>(in);
+
+    uint32_t tokens = get<uint32_t>(in);
+    if (tokens == 0 || !fits(in, size, tokens, 16)) return nullptr;         // a type, line, number and length each
+    std::vector<lexer::Token> statement(tokens);
+    for (lexer::Token& token : statement) {
+      uint32_t type = get<uint32_t>(in);
+      unsigned int line = get<uint32_t>(in);
+      unsigned int number = get<uint32_t>(in);
+      std::string value = getString(in, size);
+      if (!in || type >= lexer::ERROR) return nullptr;
+      token = lexer::Token(static_cast<lexer::TOKEN>(type), std::string_view(value), line, number);
+    }
+
+    syntax::Node* node;
+    try { node = parser::Parser::parseStatement(statement); }
+    catch (const std::exception&) { return nullptr; }                       // the grammar has changed since the file was written
+
+    syntax::InstructionNode* instruction = dynamic_cast<syntax::InstructionNode*>(node);
+    if (instruction == nullptr) { delete node; return nullptr; }
+    image->text.push_back(instruction);
+
+    syntax::BranchNode* branch = dynamic_cast<syntax::BranchNode*>(instruction);
+    if (branch != nullptr) branch->link(address);
+  }
+
+  if (!in) return nullptr;
+  return image;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file cache.h
+ * Keeps recently assembled programs keyed by a hash of their source text so that running an unchanged
+ * program skips lexing, parsing and layout entirely. Images can optionally be written to a directory in a
+ * versioned binary format so that they survive between sessions.
+ * @date 18/10/26
+ */
+
+#ifndef IRISC_CACHE_H
+#define IRISC_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <optional>
+#include "windows/memory.h"
+
+namespace vm {
+
+  uint64_t hash(std::string_view, uint64_t seed = 0);
+
+  class Cache {
+    private:
+      static constexpr uint32_t MAGIC = 0x43534952;       // "RISC" in little endian
+      static constexpr uint32_t VERSION = 1;
+
+      struct Entry {
+        uint64_t key;
+        size_t length;                                    // source length, as a cheap guard against collisions
+        std::shared_ptr<Image> image;
+      };
+
+      size_t capacity;
+      std::list<Entry> entries;                           // most recently used at the front
+      std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+      std::optional<std::string> _directory;
+      mutable std::mutex mutex;                           // the editor looks programs up while the emulator thread inserts them
+
+      void remember(uint64_t, size_t, std::shared_ptr<Image>);
+      std::string path(uint64_t) const;
+      std::shared_ptr<Image> read(uint64_t, size_t) const;
+      std::shared_ptr<Image> decode(std::istream&, uint64_t, size_t, uint64_t) const;
+      void write(uint64_t, size_t, const Image&) const;
+
+    public:
+      Cache(size_t capacity = 16);
+      std::shared_ptr<Image> find(std::string_view);
+      void insert(std::string_view, std::shared_ptr<Image>);
+      void directory(std::string);
+      void clear();
+  };
+
+}
+
+#endif //IRISC_CACHE_H
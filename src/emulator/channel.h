@@ -0,0 +1,55 @@
+/**
+ * @file channel.h
+ * A bounded lock-free queue for handing values from exactly one producer thread to exactly one consumer
+ * thread. The producer only writes the tail and the consumer only writes the head, so neither ever waits
+ * on the other.
+ * @date 18/10/26
+ */
+
+#ifndef IRISC_CHANNEL_H
+#define IRISC_CHANNEL_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace vm {
+
+  template <typename T, size_t N>
+  class Channel {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "channel capacity must be a power of two");
+
+    private:
+      std::array<T, N> slots;
+      alignas(64) std::atomic<size_t> head = 0;         // next slot to read, written by the consumer
+      alignas(64) std::atomic<size_t> tail = 0;         // next slot to write, written by the producer
+
+    public:
+      /**
+       * Called by the producer. Returns false, leaving the value untouched, if the channel is full.
+       */
+      bool push(T&& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+
+        slots[t & (N - 1)] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+      }
+
+      /**
+       * Called by the consumer. Returns false if the channel is empty.
+       */
+      bool pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+
+        value = std::move(slots[h & (N - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+      }
+  };
+}
+
+#endif //IRISC_CHANNEL_H
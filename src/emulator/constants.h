@@ -1,6 +1,6 @@
 /**
  * @file emulator/constants.h
- * Holds maps which are useful as lookup tables to convert variables into human readable explanations.
+ * Holds arrays indexed by the emulator enums which convert them into human readable explanations.
  * @author Rory Pinkney
  * @date 20/11/20
  */
@@ -8,8 +8,6 @@
 #ifndef IRISC_EMULATOR_CONSTANTS_H
 #define IRISC_EMULATOR_CONSTANTS_H
 
-#include <map>
-
 namespace vm {
   //******************************************************************************************
   // CPSR FLAGS
@@ -20,19 +18,19 @@ namespace vm {
     V   // overflow
   };
 
-  static std::map<FLAG, std::string> flagShortName {
-    {N, "N"}, {Z, "Z"}, {C, "C"}, {V, "V"}
+  inline constexpr const char* flagShortName[4] = {
+    "N", "Z", "C", "V"
   };
 
-  static std::map<FLAG, std::string> flagTitle {
-    {N, "Negative Flag (N)"}, {Z, "Zero Flag (Z)"}, {C, "Carry Flag (C)"}, {V, "Overflow Flag (V)"}
+  inline constexpr const char* flagTitle[4] = {
+    "Negative Flag (N)", "Zero Flag (Z)", "Carry Flag (C)", "Overflow Flag (V)"
   };
 
-  static std::map<FLAG, std::string> flagExplain {
-    {N, "This bit is set when the signed result of the operation is negative."}, 
-    {Z, "This bit is set when the result of the operation is equal to zero."}, 
-    {C, "This bit is set when the operation results in an unsigned overflow."}, 
-    {V, "This bit is set when the operation results in a signed overflow."}
+  inline constexpr const char* flagExplain[4] = {
+    "This bit is set when the signed result of the operation is negative.", 
+    "This bit is set when the result of the operation is equal to zero.", 
+    "This bit is set when the operation results in an unsigned overflow.", 
+    "This bit is set when the operation results in a signed overflow."
   };
 
 
@@ -42,6 +40,27 @@ namespace vm {
     TEXT, 
     DATA
   };
+
+
+  //******************************************************************************************
+  // WINDOWS
+  enum WINDOW {
+    REGISTERS,
+    MACHINE_CODE,
+    MEMORY
+  };
+
+
+  //******************************************************************************************
+  // INSTRUMENTS
+  enum INSTRUMENT {
+    PROFILING = 1 << 0,     // counts instructions and follows calls
+    TIMING = 1 << 1,        // estimates cycles with a timing model
+    CACHING = 1 << 2,       // passes memory accesses through simulated caches
+    PREDICTING = 1 << 3,    // shows branches to simulated branch predictors
+    TRACING = 1 << 4,       // records every instruction executed in a binary trace
+    INSTRUMENTS = 1 << 5    // the number of combinations of the above
+  };
 }
 
 #endif // IRISC_EMULATOR_CONSTANTS_H
\ No newline at end of file
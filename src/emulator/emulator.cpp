@@ -1,7 +1,11 @@
 #include <iostream>
+#include <array>
 #include <bit>
 #include <thread>
 #include <chrono>
+#include <utility>
+#include <stdexcept>
+#include <FL/Fl.H>
 #include "emulator.h"
 #include "../parser/parser.h"
 #include "../error.h"
@@ -9,337 +13,552 @@
 
 using namespace vm;
 
-Emulator::Emulator() : memory(), registers(), instruction(), _running(false) {};
+Emulator::Emulator() : memory(), registers(), instruction(), editor(nullptr), _running(false), lexer(""), parser(lexer), ticker(&Emulator::tick<0>) {
+  worker = std::thread([this]{ work(); });
+  Fl::add_timeout(1.0 / fps, refresh_cb, this);
+};
 
+Emulator::~Emulator() {
+  Fl::remove_timeout(refresh_cb, this);
+  shutdown();
+}
 
-void Emulator::reset() {
-  registers.clear();
-  // stack.reset();
+void Emulator::refresh_cb(void* emulator) {
+  Emulator* self = (Emulator*)emulator;
+  self->refresh();
+  Fl::repeat_timeout(1.0 / self->fps, refresh_cb, emulator);
 }
 
-void Emulator::execute(std::string statement) {
-  lexer::Lexer lexer(statement);
-  parser::Parser parser(lexer);
-  syntax::Node* node = parser.parseSingle();
+/**
+ * Brings the windows up to date with the emulator. This runs on the FLTK thread at a fixed rate however fast 
+ * the program is running, so the emulator thread never waits on the GUI and only the latest state is drawn.
+ */
+void Emulator::refresh() {
+  registers.show(snapshot());
+  instruction.refresh();
+  if (ui::Editor* editor = this->editor) editor->refresh();
+}
 
+/**
+ * Shows or hides one of the emulator windows. None of them are built until they are first shown, so a session
+ * which only uses the console never creates them.
+ */
+void Emulator::toggle(WINDOW window) {
+  switch (window) {
+    case REGISTERS: registers.toggle(); break;
+    case MACHINE_CODE: instruction.toggle(); break;
+    case MEMORY: memory.toggle(); break;
+  }
+}
 
-  // std::cout << "\n******* node *******\n" << node->toString() << "\n******* end  *******\n" << std::endl;
+/**
+ * Stops the emulator thread once it finishes what it is doing. The FLTK lock must not be held, since the 
+ * thread may need it to finish updating the windows.
+ */
+void Emulator::shutdown() {
+  quit = true;
+  pending++;
+  { std::lock_guard lock(mutex); }
+  wakeup.notify_one();
 
-  if (node != nullptr) execute(node);
-  free(node);
+  if (worker.joinable()) worker.join();
 }
 
 /**
- * Driver function to execute any instruction with a base class of InstructionNode
+ * The body of the emulator thread. Commands from both queues are handled as they arrive, and a running 
+ * program is stepped between them, so nothing else ever touches the machine state.
  */
-void Emulator::execute(syntax::Node* node) {
-  registers.prepare();
-
-  if (dynamic_cast<syntax::InstructionNode*>(node)) {
-    bool executed = false;
-    if (dynamic_cast<syntax::BiOperandNode*>(node)) {
-      executed = executeBiOperand(dynamic_cast<syntax::BiOperandNode*>(node));
-    }
-    else if (dynamic_cast<syntax::TriOperandNode*>(node)) {
-      executed = executeTriOperand(dynamic_cast<syntax::TriOperandNode*>(node));
+void Emulator::work() {
+  auto next = std::chrono::steady_clock::now();
+  uint64_t drained = 0;
+
+  while (!quit) {
+    uint64_t seen = pending;
+
+    if (seen != drained) {                            // the queues are only looked at once a command has been sent
+      Command command;
+      while (interactive.pop(command)) {
+        try { handle(command); }
+        catch (...) { failure = std::current_exception(); }
+
+        publish();                                    // before completing, so the REPL sees its own command
+        completed++;
+        completed.notify_all();
+      }
+      while (gui.pop(command)) {
+        try { handle(command); }
+        catch (const std::exception &e) { std::cerr << e.what() << std::endl; }
+        publish();
+      }
+      drained = seen;
     }
-    else if (dynamic_cast<syntax::ShiftNode*>(node)) {
-      executed = executeShift(dynamic_cast<syntax::ShiftNode*>(node));
+
+    std::chrono::milliseconds pause = delay;
+    bool due = pause == pause.zero() || std::chrono::steady_clock::now() >= next;
+    if (_running && due) {
+      try { (this->*ticker)(); }
+      catch (const std::exception &e) { 
+        std::cerr << e.what() << std::endl; 
+        finish();
+      }
+      publish();
+
+      if (pause == pause.zero()) continue;            // nothing to wait for, so the next instruction runs straight away
+      next = std::chrono::steady_clock::now() + pause;
     }
 
-    instruction.set(dynamic_cast<syntax::InstructionNode*>(node), executed);
+    std::unique_lock lock(mutex);
+    auto woken = [&]{ return pending != seen; };
+    if (_running) wakeup.wait_until(lock, next, woken);
+    else wakeup.wait(lock, woken);
   }
-  
-  else if (dynamic_cast<syntax::AllocationNode*>(node)) {
+}
 
-  }
-  else if (dynamic_cast<syntax::LabelNode*>(node)) {
-    throw InteractiveError("Label instructions are not executable on their own. Try using the editor (:editor) to execute multiple lines.", node->statement(), 0);
+/**
+ * Carries out a single command on the emulator thread.
+ */
+void Emulator::handle(Command& command) {
+  switch (command.kind) {
+    case Command::RUN:
+      if (_running) break;
+
+      if (command.image) memory.load(command.image);                  // unchanged programs skip assembly entirely
+      else {
+        memory.softReset();
+        Assembler assembler(memory);
+        if (command.lines.empty()) assembler.assemble(command.program);
+        else {
+          for (int i = 0; i < command.lines.size(); i++) {
+            if (command.lines[i] == nullptr) continue;
+
+            command.lines[i]->relocate(i + 1);
+            assembler.emit(command.lines[i].release());
+          }
+          assembler.link();
+        }
+        cache.insert(command.program, memory.image());
+      }
+
+      launch();
+      break;
+
+    case Command::CONTINUE:
+      if (!_running && inProgram()) _running = true;
+      break;
+
+    case Command::STEP:
+      if (!_running && inProgram()) {
+        (this->*ticker)();
+        if (!inProgram()) finish();
+      }
+      break;
+
+    case Command::STOP:
+      if (_running) finish();
+      break;
+
+    case Command::RESET:
+      registers.clear();
+      steps = 0;
+      if (timing) timing->reset(*memory.image());
+      if (caches) caches->reset(*memory.image());
+      if (predictors) predictors->reset(*memory.image());
+      // stack.reset();
+      break;
+
+    case Command::EXECUTE:
+      execute(command.node);
+      steps++;
+      break;
+
+    case Command::BREAK:
+      if (!breakpoints.erase(command.line)) breakpoints.insert(command.line);
+      break;
+
+    case Command::PROFILE:
+      instrument(PROFILING, command.period != 0);
+      profiler.sample(std::max(command.period, 1u));
+      if (command.period) profiler.reset(*memory.image(), (registers[syntax::PC] - memory.memstart()) / 32);
+      else profiler.clear();
+      if (ui::Editor* editor = this->editor) editor->heat({});
+      break;
+
+    case Command::REPORT:
+      if (profiler.empty()) throw std::runtime_error("Nothing has been profiled. Use ':profile on' and run a program first.");
+      *command.report = profiler.report(command.view, *memory.image());
+      break;
+
+    case Command::TIME:
+      timing = std::move(command.timing);
+      if (timing) timing->reset(*memory.image());
+      instrument(TIMING, bool(timing));
+      break;
+
+    case Command::CACHES:
+      caches = std::move(command.caches);
+      if (caches) caches->reset(*memory.image());
+      instrument(CACHING, bool(caches));
+      break;
+
+    case Command::CACHE_REPORT:
+      if (!caches) throw std::runtime_error("No caches are being simulated. Set some up with ':caches' first.");
+      *command.report = caches->report(*memory.image());
+      break;
+
+    case Command::PREDICT:
+      predictors = std::move(command.predictors);
+      if (predictors) predictors->reset(*memory.image());
+      instrument(PREDICTING, bool(predictors));
+      break;
+
+    case Command::PREDICT_REPORT:
+      if (!predictors) throw std::runtime_error("No branch predictors are being simulated. Choose some with ':predict' first.");
+      *command.report = predictors->report(*memory.image());
+      break;
+
+    case Command::TRACE:
+      tracer = std::move(command.trace);
+      instrument(TRACING, bool(tracer));
+      break;
+
+    case Command::TRACED:
+      if (!tracer) throw std::runtime_error("Nothing is being traced. Start a trace with ':trace' first.");
+      *command.records = tracer->recent(command.count);
+      break;
+
+    case Command::TRACE_SAVE:
+      if (!tracer) throw std::runtime_error("Nothing is being traced. Start a trace with ':trace' first.");
+      if (tracer->toFile()) throw std::runtime_error("The trace is already being written to a file. Read it with irisc-trace.");
+      Trace::save(command.path, tracer->recent(SIZE_MAX));
+      break;
   }
 }
 
 /**
- * Parses and runs a string containing a series of statements
+ * Queues a command for the emulator thread and wakes it up.
  */
-void Emulator::run(std::string program) {
-  lexer::Lexer lexer(program);
-  // std::vector<lexer::Token> tokens = lexer.getTokens();
-  // for (lexer::Token token : tokens) std::cout << lexer::tokenNames[token.type()] << ", ";
-  // std::cout << std::endl;
+void Emulator::send(Channel<Command, 64>& channel, Command&& command) {
+  while (!channel.push(std::move(command))) std::this_thread::yield();
 
-  parser::Parser parser(lexer);
-  std::vector<syntax::Node*> nodes = parser.parseMultiple();
+  pending++;
+  { std::lock_guard lock(mutex); }                    // the worker is either before its check or already waiting
+  wakeup.notify_one();
+}
 
-  // std::cout << "\n******* nodes *******" << std::endl;
-  // for (syntax::Node* node : nodes) std::cout << node->toString() << std::endl;
-  // std::cout <<   "*******  end  *******\n" << std::endl;
+/**
+ * Sends a command from the REPL thread and waits for the emulator thread to finish it, so errors can be 
+ * reported against the line which caused them.
+ */
+void Emulator::request(Command&& command) {
+  uint64_t ticket = ++submitted;
+  send(interactive, std::move(command));
 
-  start(nodes);
-  // for (auto node : nodes) free(node);
+  uint64_t done;
+  while ((done = completed) < ticket) completed.wait(done);
+  if (failure) std::rethrow_exception(std::exchange(failure, nullptr));
+}
+
+void Emulator::reset() {
+  request({ .kind = Command::RESET });
 }
 
 /**
- * Prepares the program nodes
+ * Executes a single interactive statement. The statement is parsed into a node held by the emulator rather
+ * than on the heap, and the lexer and parser keep their scratch space between statements. Parsing happens
+ * on the REPL thread; only the execution itself is handed to the emulator thread.
  */
-void Emulator::start(std::vector<syntax::Node*> nodes) {
-  if (_running) return;
+void Emulator::execute(std::string_view input) {
+  lexer.reset(input, 0);                                  // interactive statements have no source line
+  parser.parseSingle(statement);
 
-  memory.softReset();
-  registers[syntax::PC] = memory.memstart();
-
-  bool text = true;
-  bool entry_point = false;
-  std::vector<int> remove;
-  for (int i = 0; i < nodes.size(); i++) {
-    if (dynamic_cast<syntax::DirectiveNode*>(nodes[i])) {
-      syntax::DirectiveNode* node = dynamic_cast<syntax::DirectiveNode*>(nodes[i]);
-      if (node->isData()) text = false;
-      else if (node->isText()) { text = true; remove.push_back(i); }
-      else if (node->isGlobal()) entry_point = true;
-    }
-    else if (dynamic_cast<syntax::AllocationNode*>(nodes[i])) {
-      if (text) throw AssemblyError("Cannot declare data outside of the data section.", nodes[i]->statement());
-      else {
-        memory.allocate(dynamic_cast<syntax::AllocationNode*>(nodes[i]));
-      }
-    }
-    else if (dynamic_cast<syntax::LabelNode*>(nodes[i])) {
-      if (!text) throw AssemblyError("Cannot declare branchable labels outside of the text section.", nodes[i]->statement());
-      if (entry_point) {
-        registers[syntax::PC] = memory.memstart() + ((i - remove.size()) * 32);
-        entry_point = false;
-      }
+  if (syntax::Node* node = syntax::node(statement)) request({ .kind = Command::EXECUTE, .node = node });
+}
 
-      syntax::LabelNode* node = dynamic_cast<syntax::LabelNode*>(nodes[i]);
-      memory.addLabel(node->identifier(), i - remove.size());
-      remove.push_back(i);
-    }
+/**
+ * Executes the next instruction of a paused program.
+ */
+void Emulator::step() {
+  request({ .kind = Command::STEP });
+}
 
-    if (!text) remove.push_back(i);
-  }
+/**
+ * Continues a paused program.
+ */
+void Emulator::resume() {
+  request({ .kind = Command::CONTINUE });
+}
 
-  std::reverse(remove.begin(), remove.end());
-  for (int i : remove) {
-    free(nodes[i]);
-    nodes.erase(nodes.begin() + i);
-  }
+/**
+ * Sets a breakpoint on a source line, or removes it if there already is one. Programs pause before 
+ * executing an instruction on a line with a breakpoint.
+ */
+void Emulator::breakpoint(unsigned int line) {
+  request({ .kind = Command::BREAK, .line = line });
+}
+
+/**
+ * Turns profiling on, or off for a period of 0. While it is on, every instruction a program reaches is counted,
+ * and the counts are shown as a heat map in the editor when the program finishes. The call stack is sampled 
+ * once every period instructions, so a period of 1 charges every instruction to its function. Turning it off 
+ * costs nothing per instruction.
+ */
+void Emulator::profile(unsigned int period) {
+  request({ .kind = Command::PROFILE, .period = period });
+}
 
-  std::vector<syntax::InstructionNode*> instructions;
-  for (syntax::Node* node : nodes) instructions.push_back(dynamic_cast<syntax::InstructionNode*>(node));
-  memory.setText(instructions);
+/**
+ * A report of the last program run with profiling on.
+ */
+std::string Emulator::report(Profiler::VIEW view) {
+  std::string report;
+  request({ .kind = Command::REPORT, .view = view, .report = &report });
+  return report;
+}
 
-  std::thread([this]{ this->run(); }).detach();
+/**
+ * Estimates cycles with a model of a pipeline with the given number of stages, or stops estimating them for 0.
+ */
+void Emulator::time(unsigned int stages) {
+  request({ .kind = Command::TIME, .timing = stages ? TimingModel::pipeline(stages) : nullptr });
 }
 
 /**
- * 
- */ 
-void Emulator::run() {
-  _running = true;
+ * Passes the memory accesses of programs through simulated caches, the first level first, or stops simulating
+ * them if there are no levels.
+ */
+void Emulator::simulate(const std::vector<CacheLevel::Config>& levels) {
+  request({ .kind = Command::CACHES, .caches = levels.empty() ? nullptr : std::make_unique<CacheHierarchy>(levels) });
+}
 
-  while (running()) {
-    syntax::InstructionNode* node = memory.instruction(registers[syntax::PC]);
-    std::cout << "PC: " << registers[syntax::PC] << ": " << node->toString() << std::endl;
-    editor->highlightLine(node->statement()[0].lineNumber());
+/**
+ * The hits and misses of the last program run with caches simulated.
+ */
+std::string Emulator::cacheReport() {
+  std::string report;
+  request({ .kind = Command::CACHE_REPORT, .report = &report });
+  return report;
+}
 
-    if (dynamic_cast<syntax::BranchNode*>(node)) {
-      registers.prepare();
-      bool executed = executeBranch(dynamic_cast<syntax::BranchNode*>(node));
-      if (!executed) registers[syntax::PC] += 32;                     // increment to the next instruction
-    }
-    else {
-      execute(node);
-      registers[syntax::PC] += 32;                                    // increment to the next instruction
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-  }
+/**
+ * Shows the branches of programs to each of the given predictors, the first of which decides the cycles lost to
+ * mispredictions if they are being estimated, or stops predicting them if there are none.
+ */
+void Emulator::predict(const std::vector<Predictor::KIND>& kinds) {
+  request({ .kind = Command::PREDICT, .predictors = kinds.empty() ? nullptr : std::make_unique<Predictors>(kinds) });
+}
 
-  _running = false;
-  editor->highlightLine(-1);          // unhighlight all lines
-  registers.prepare();
+/**
+ * The predictions made for the last program run with branch predictors.
+ */
+std::string Emulator::predictionReport() {
+  std::string report;
+  request({ .kind = Command::PREDICT_REPORT, .report = &report });
+  return report;
 }
 
-bool Emulator::running() {
-  return _running && registers[syntax::PC] < (memory.memstart() + (memory.text().size() * 32));
+/**
+ * Records every instruction executed from now on in the given trace, or stops tracing if there is none. A trace
+ * being replaced is closed, finishing its file if it has one.
+ */
+void Emulator::trace(std::unique_ptr<Trace> trace) {
+  request({ .kind = Command::TRACE, .trace = std::move(trace) });
 }
 
-void Emulator::stop() {
-  _running = false;
+/**
+ * Up to the given number of the most recent records of the current trace, oldest first.
+ */
+std::vector<Record> Emulator::traced(size_t count) {
+  std::vector<Record> records;
+  request({ .kind = Command::TRACED, .count = count, .records = &records });
+  return records;
 }
 
 /**
- * Simplifies the flex operand down to a single source value, fetching register values and applying shifts.
+ * Writes the records in the ring buffer of the current trace out to a file which irisc-trace can read.
  */
-uint32_t Emulator::deflex(syntax::FlexOperand flex) {
-  int deflex;
+void Emulator::saveTrace(std::string path) {
+  request({ .kind = Command::TRACE_SAVE, .path = std::move(path) });
+}
 
-  auto [Rm, shift, Rs, immShift] = flex.unpack();
-  if (flex.isImm()) return std::rotr((uint32_t)std::get<int>(Rm), immShift);      // return value of immediate (short circuit)
-  else deflex = registers[std::get<syntax::REGISTER>(Rm)];                        // get value in register
+/**
+ * Executes a single interactive statement. Branches only mean something within a program, so are not executed.
+ */
+void Emulator::execute(syntax::Node* node) {
+  registers.prepare();
 
-  if (flex.shifted()) {
-    int shiftBy;
-    if (flex.shiftedByImm()) shiftBy = std::get<int>(flex.Rs());                  // get value of immediate shift
-    else shiftBy = registers[std::get<syntax::REGISTER>(flex.Rs())];              // get value in shift register
+  if (syntax::InstructionNode* executable = dynamic_cast<syntax::InstructionNode*>(node)) {
+    bool executed = false;
+    if (!dynamic_cast<syntax::BranchNode*>(node)) {
+      Decoded decoded = predecode(*executable);
+      executed = registers.checkFlags(decoded.cond);
+      if (executed) decoded.handler(registers, decoded);
+    }
 
-    deflex = applyFlexShift(flex.shift(), deflex, shiftBy);                           // apply the unpacked shift
+    if (instruction.exists()) instruction.set(executable, executed);
   }
   
-  return deflex;
+  else if (dynamic_cast<syntax::AllocationNode*>(node)) {
+
+  }
+  else if (dynamic_cast<syntax::LabelNode*>(node)) {
+    throw InteractiveError("Label instructions are not executable on their own. Try using the editor (:editor) to execute multiple lines.", node->statement(), 0);
+  }
 }
 
 /**
- * Applies a single shift operation.
+ * Parses and runs a string containing a series of statements.
  */
-uint32_t Emulator::applyFlexShift(syntax::SHIFT shift, int value, int amount) {
-  switch(shift) {
-    case syntax::LSL:
-      return value <<= amount;
-    case syntax::LSR:
-      if (amount == 0) amount = 32;       // special case for right shifts
-      return value >>= amount;
-    default:
-      throw std::runtime_error("");
-  }
+void Emulator::run(std::string program) {
+  if (_running) return;
+
+  std::shared_ptr<Image> image = cache.find(program);
+  send(gui, { .kind = Command::RUN, .program = std::move(program), .image = image });
 }
 
 /**
- * Executes any bi-operand instruction such as MOV, MVN and comparisions CMP, TST etc
+ * Runs a program which the caller has already parsed line by line, e.g. by the editor as it is typed. 
+ * lines[i] holds the statement on line i + 1, or nullptr if the line is blank. The nodes are copied so 
+ * the caller keeps ownership of them.
  */
-bool Emulator::executeBiOperand(syntax::BiOperandNode* instruction) {
-  auto [op, cond, set, dest, flex] = instruction->unpack();           // unpack the instruction
-  if (!registers.checkFlags(cond)) return false;                            // returns early if condition code is not satisfied
+void Emulator::run(std::string program, std::vector<const syntax::Node*> lines) {
+  if (_running) return;
 
-  uint32_t src = deflex(flex);                                        // deflex the flex operand into a single value
-  switch(op) {                                                        // check opcode and execute instruction
-    case syntax::MOV:
-      if (set) registers.setFlags(registers[dest], src, src);
-      registers[dest] = src;
-      break;
-    case syntax::MVN:
-      if (set) registers.setFlags(registers[dest], -src, -src);
-      registers[dest] = -src;
-      break;
-    case syntax::CMP:
-      registers.setFlags(registers[dest], src, (uint64_t)registers[dest] - src, '-');
-      break;
-    case syntax::CMN:
-      registers.setFlags(registers[dest], src, (uint64_t)registers[dest] + src, '+');
-      break;
-    case syntax::TST:
-      registers.setFlags(registers[dest], src, (uint64_t)registers[dest] & src);
-      break;
-    case syntax::TEQ:
-      registers.setFlags(registers[dest], src, (uint64_t)registers[dest] ^ src);
-      break;
-  } 
+  Command command { .kind = Command::RUN, .image = cache.find(program) };
+  if (!command.image) {
+    for (const syntax::Node* line : lines) command.lines.emplace_back(line ? line->clone() : nullptr);
+  }
+  command.program = std::move(program);
+
+  send(gui, std::move(command));
+}
 
-  return true;
+void Emulator::stop() {
+  send(gui, { .kind = Command::STOP });
 }
 
 /**
- * TODO: implement arithmetic with carry (ADC SBC and RSC)
- * Executes any tri-operand arithmetic opereration (besides shifts)
+ * Keeps assembled programs on disk in the given directory as well as in memory
  */
-bool Emulator::executeTriOperand(syntax::TriOperandNode* instruction) {
-  auto [op, cond, set, dest, src, flex] = instruction->unpack();    // unpack the instruction
-  if (!registers.checkFlags(cond)) return false;                          // returns early if condition code is not satisfied
-
-  uint32_t n = registers[src];
-  uint32_t m = deflex(flex);                                        // deflex the flex operand into a value
-  int result;
-  switch (op) {                                                      // check opcode and execute instruction
-    case syntax::AND:
-      if (set) registers.setFlags(n, m, (uint64_t)n & m);
-      result = n & m;
-      break;
-    case syntax::EOR:
-      if (set) registers.setFlags(n, m, (uint64_t)n ^ m);
-      result = n ^ m;
-      break;
-    case syntax::ORR:
-      if (set) registers.setFlags(n, m, (uint64_t)n | m);
-      result = n | m;
-      break;
-    case syntax::ADD:
-      if (set) registers.setFlags(n, m, (uint64_t)n + m, '+');
-      result = n + m;
-      break;
-    case syntax::SUB:
-      if (set) registers.setFlags(n, m, (uint64_t)n - m, '-');
-      result = n - m;
-      break;
-    case syntax::RSB:
-      if (set) registers.setFlags(m, n, (uint64_t)m - n, '-');
-      result = m - n;
-  } 
+void Emulator::cacheDirectory(std::string directory) {
+  cache.directory(directory);
+}
 
-  registers[dest] = result;
-  return true;
+/**
+ * Points the PC at the program entry point, tells any listener about the program and starts stepping
+ * through it, unless the first instruction has a breakpoint.
+ */
+void Emulator::launch() {
+  steps = 0;
+  memory.predecode();
+  registers[syntax::PC] = memory.entry().value_or(memory.memstart());
+  if (instruments & PROFILING) profiler.reset(*memory.image(), (registers[syntax::PC] - memory.memstart()) / 32);
+  if (timing) timing->reset(*memory.image());
+  if (caches) caches->reset(*memory.image());
+  if (predictors) predictors->reset(*memory.image());
+  if (loaded) loaded(*memory.image());
+
+  if (!inProgram()) return;
+  if (!atBreakpoint()) _running = true;
+  else if (ui::Editor* editor = this->editor) editor->highlightLine(memory.instruction(registers[syntax::PC])->statement()[0].lineNumber());
 }
 
 /**
- * TODO: implement ASR and ROR
- * Executes a shift operation
- */ 
-bool Emulator::executeShift(syntax::ShiftNode* instruction) {
-  auto [op, cond, set, dest, src1, src2] = instruction->unpack();     // unpack the instruction
-  if (!registers.checkFlags(cond)) return false;                            // returns early if condition code is not satisfied
+ * Executes the instruction at the PC, then pauses if the next one has a breakpoint or finishes if the 
+ * program has ended. There is a version for each combination of instruments, so that those not in use 
+ * cost nothing.
+ */
+template <unsigned int INSTRUMENTS>
+void Emulator::tick() {
+  uint32_t pc = registers.value(syntax::PC);
+  [[maybe_unused]] size_t index = (pc - memory.memstart()) / 32;
+  syntax::InstructionNode* node = memory.instruction(pc);
+  const Decoded& decoded = memory.decoded(pc);
+  ui::Editor* editor = this->editor;
+  if (editor) editor->highlightLine(node->statement()[0].lineNumber());
 
-  uint32_t n = registers[src1];
-  uint32_t m;
-  if (src2.index() == 1) m = registers[std::get<syntax::REGISTER>(src2)];
-  else m = std::get<int>(src2);
+  registers.prepare();
+  bool executed = registers.checkFlags(decoded.cond);
+  if constexpr (INSTRUMENTS & PROFILING) profiler.record(index, executed);
+  if constexpr (INSTRUMENTS & CACHING) caches->fetch(memory.memstart() / 8 + index * 4, index);   // the PC counts bits; caches take bytes
+  bool branched = executed && decoded.handler(registers, decoded);
+  if (!branched) registers[syntax::PC] += 32;                       // increment to the next instruction
+  else if constexpr (INSTRUMENTS & PROFILING) profiler.branch(index, (registers.value(syntax::PC) - memory.memstart()) / 32);
+  [[maybe_unused]] bool mispredicted = false;
+  if constexpr (INSTRUMENTS & PREDICTING) mispredicted = predictors->resolve(index, executed, (registers.value(syntax::PC) - memory.memstart()) / 32);
+  if constexpr (INSTRUMENTS & TIMING) timing->retire(index, executed, branched, mispredicted);
+  if constexpr (INSTRUMENTS & TRACING) record(pc, executed);
+  if (!decoded.branch && instruction.exists()) instruction.set(node, executed);       // nothing to copy until the window is built
+  steps++;
+
+  if (!inProgram()) { 
+    if (_running) finish(); 
+  }
+  else if (atBreakpoint()) {
+    _running = false;
+    if (editor) editor->highlightLine(memory.instruction(registers[syntax::PC])->statement()[0].lineNumber());
+  }
+}
 
-  int result;
-  switch (op) {                                                        // check opcode and execute instruction
-    case syntax::LSL:
-      if (set) registers.setFlags(n, m, n << m);
-      result = n << m;
-      break;
-    case syntax::LSR:
-      if (set) registers.setFlags(n, m, n >> m);
-      result = n >> m;
-      break;
-    case syntax::ASR:
-    case syntax::ROR:
-    default:
-      break;
+/**
+ * Appends the instruction just executed to the trace: its machine code, the lowest register it wrote other
+ * than the PC, and the flags it left behind.
+ */
+void Emulator::record(uint32_t pc, bool executed) {
+  Record record { .pc = pc, .word = memory.word(pc) };
+  uint16_t written = registers.written() & ~(1 << syntax::PC);
+  if (written) {
+    record.reg = std::countr_zero(written);
+    record.value = registers.value(record.reg);
   }
 
-  registers[dest] = result;
-  return true;
+  record.flags = registers.flag(N) << 7 | registers.flag(Z) << 6 | registers.flag(C) << 5 | registers.flag(V) << 4;
+  if (executed) record.flags |= Record::EXECUTED;
+  tracer->append(record);
 }
 
 /**
- * TODO: implement
- * Executes a branch operation
- */ 
-bool Emulator::executeBranch(syntax::BranchNode* instruction) {
-  auto [op, cond, to] = instruction->unpack();
-  if (!registers.checkFlags(cond)) return false;                          // returns early if condition code is not satisfied
+ * Turns an instrument on or off and switches to the version of tick with just the instruments in use.
+ */
+void Emulator::instrument(INSTRUMENT instrument, bool enable) {
+  static constexpr auto tickers = []<size_t... i>(std::index_sequence<i...>) {
+    return std::array<void (Emulator::*)(), INSTRUMENTS> {&Emulator::tick<i>...};
+  }(std::make_index_sequence<INSTRUMENTS>());
 
-  int address;
-  if (to.index() == 0) address = registers[std::get<syntax::REGISTER>(to)];
-  else address = memory.label(std::get<std::string>(to));
-  
-  switch (op) {
-    case syntax::B:
-      // std::cout << "B" << std::endl;
-      registers[syntax::PC] = address;
-      break;
-    case syntax::BL:
-      // std::cout << "BL" << std::endl;
-      registers[syntax::LR] = registers[syntax::PC] + 32;
-      registers[syntax::PC] = address;
-      break;
-    case syntax::BX:
-      // std::cout << "BX" << std::endl;
-      registers[syntax::PC] = address;
-      break;
+  instruments = enable ? instruments | instrument : instruments & ~instrument;
+  ticker = tickers[instruments];
+}
+
+/**
+ * Ends the current program run.
+ */
+void Emulator::finish() {
+  _running = false;
+  if (ui::Editor* editor = this->editor) {
+    editor->highlightLine(-1);                                            // unhighlight all lines
+    if (!profiler.empty()) editor->heat(profiler.lines(*memory.image()));
   }
+  registers.prepare();
+}
+
+/**
+ * Publishes the current machine state for observers on other threads. Only called by the worker, which is
+ * the sole writer, so readers never hold it up.
+ */
+void Emulator::publish() {
+  State current;
+  registers.capture(current);
+  current.running = _running;
+  current.steps = steps;
+  current.cycles = timing ? timing->cycles() : 0;
+  state.publish(current);
+}
+
+bool Emulator::inProgram() {
+  return registers[syntax::PC] < (memory.memstart() + (memory.size() * 32));
+}
 
-  return true;
+bool Emulator::atBreakpoint() {
+  return !breakpoints.empty() && breakpoints.contains(memory.instruction(registers[syntax::PC])->statement()[0].lineNumber());
 }
 
 /**
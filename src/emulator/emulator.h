@@ -11,13 +11,33 @@
 
 #include <iostream>
 #include <bitset>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <set>
+#include <algorithm>
 #include <FL/Fl_Window.H>
 #include <FL/Fl_Box.H>
 #include "windows/heap.h"
 #include "windows/memory.h"
 #include "windows/registers.h"
 #include "windows/instruction.h"
+#include "assembler.h"
+#include "cache.h"
+#include "channel.h"
+#include "snapshot.h"
+#include "handlers.h"
+#include "profiler.h"
+#include "timing.h"
+#include "hierarchy.h"
+#include "predictor.h"
+#include "trace.h"
 #include "../parser/syntax.h"
+#include "../parser/parser.h"
 #include "../ui/editor.h"
 #include "constants.h"
 
@@ -27,39 +47,124 @@ namespace ui {
 
 namespace vm {
 
+  /**
+   * A request for the emulator thread. Only the fields used by the kind of command are filled in.
+   */
+  struct Command {
+    enum KIND { RUN, CONTINUE, STEP, STOP, RESET, EXECUTE, BREAK, PROFILE, REPORT, TIME, CACHES, CACHE_REPORT, PREDICT, PREDICT_REPORT, TRACE, TRACED, TRACE_SAVE };
+
+    KIND kind = STOP;
+    std::string program;                                  // RUN: the source, which keys the cache
+    std::shared_ptr<Image> image;                         // RUN: an image found in the cache, if any
+    std::vector<std::unique_ptr<syntax::Node>> lines;     // RUN: statements already parsed by the editor
+    syntax::Node* node = nullptr;                         // EXECUTE: the statement, owned by the sender
+    unsigned int line = 0;                                // BREAK: the source line to toggle
+    unsigned int period = 0;                              // PROFILE: instructions between call stack samples, 0 to stop
+    Profiler::VIEW view = Profiler::SUMMARY;              // REPORT: which report of the profile
+    std::string* report = nullptr;                        // REPORT, CACHE_REPORT, PREDICT_REPORT: filled in, owned by the sender
+    std::unique_ptr<TimingModel> timing;                  // TIME: the model to estimate cycles with, if any
+    std::unique_ptr<CacheHierarchy> caches;               // CACHES: the caches to simulate, if any
+    std::unique_ptr<Predictors> predictors;               // PREDICT: the branch predictors to compare, if any
+    std::unique_ptr<Trace> trace;                         // TRACE: where to record execution, if anywhere
+    size_t count = 0;                                     // TRACED: how many of the most recent records to copy
+    std::vector<Record>* records = nullptr;               // TRACED: filled in, owned by the sender
+    std::string path;                                     // TRACE_SAVE: where to write the ring buffer
+  };
+
   class Emulator {
     private:
       // Heap heap;
       Memory memory;
       Registers registers;
       Instruction instruction;
-      std::vector<syntax::Node*> program;
+      Cache cache;
       Fl_Window* window;
-      ui::Editor* editor;
+      std::atomic<ui::Editor*> editor;                // set from the REPL thread once the editor is first opened
       MODE _mode;
-      bool _running;
+      std::atomic<bool> _running;
+      std::function<void(const Image&)> loaded;      // notified with each program before it runs
+      
+      // reused for every interactive statement so that executing one does not allocate
+      lexer::Lexer lexer;
+      parser::Parser parser;
+      syntax::Statement statement;
 
-      bool executeBiOperand(syntax::BiOperandNode*);
-      bool executeTriOperand(syntax::TriOperandNode*);
-      bool executeShift(syntax::ShiftNode*);
-      bool executeBranch(syntax::BranchNode*);
-      uint32_t deflex(syntax::FlexOperand);
-      uint32_t applyFlexShift(syntax::SHIFT, int, int);
-      bool running();
+      // everything is executed on one long-lived thread which takes commands from one queue per sending thread
+      Channel<Command, 64> interactive;               // from the REPL thread, which waits for each to finish
+      Channel<Command, 64> gui;                       // from the FLTK thread, which never waits
+      std::atomic<uint64_t> pending = 0;              // bumped for every command so the worker can sleep until there is one
+      uint64_t submitted = 0;                         // REPL commands sent, only touched by the REPL thread
+      std::atomic<uint64_t> completed = 0;            // REPL commands finished, the sequence the REPL waits on
+      std::exception_ptr failure;                     // error from the REPL command which just finished
+      std::mutex mutex;
+      std::condition_variable wakeup;
+      std::atomic<bool> quit = false;
+      std::set<unsigned int> breakpoints;             // source lines, only touched by the worker
+      std::atomic<std::chrono::milliseconds> delay{std::chrono::milliseconds(1000)};   // pause between program instructions
+      std::atomic<unsigned int> fps = 30;             // how often the windows catch up with the published state
+      uint64_t steps = 0;                             // instructions executed since the last run or reset
+      Seqlock<State> state;                           // published by the worker, read from any thread
+      Profiler profiler;                              // only touched by the worker
+      std::unique_ptr<TimingModel> timing;            // only touched by the worker
+      std::unique_ptr<CacheHierarchy> caches;         // only touched by the worker
+      std::unique_ptr<Predictors> predictors;         // only touched by the worker
+      std::unique_ptr<Trace> tracer;                  // only touched by the worker
+      unsigned int instruments = 0;                   // INSTRUMENT flags for those in use
+      void (Emulator::*ticker)();                     // tick, with only the instruments in use
+      std::thread worker;
+
+      void work();
+      void handle(Command&);
+      void send(Channel<Command, 64>&, Command&&);
+      void request(Command&&);
+      void execute(syntax::Node*);
+      bool inProgram();
+      bool atBreakpoint();
+      void launch();
+      template <unsigned int INSTRUMENTS> void tick();
+      void record(uint32_t pc, bool executed);
+      void instrument(INSTRUMENT, bool);
+      void finish();
+      void publish();
+      static void refresh_cb(void*);
 
     public:
       Emulator();
-      void reset();
+      ~Emulator();
       void setEditor(ui::Editor* editor) { this->editor = editor; };
-      void calculateLabelOffsets();
-      // void assemble()
-      void execute(std::string);
-      void execute(syntax::Node*);
+      void toggle(WINDOW);
+      void listen(std::function<void(const Image&)> listener) { loaded = listener; };
+      void cacheDirectory(std::string);
+      void mode(MODE);
+      bool running() const { return _running; };
+      State snapshot() const { return state.read(); };
+      void stepDelay(unsigned int milliseconds) { delay = std::chrono::milliseconds(milliseconds); };
+      void frameRate(unsigned int hz) { fps = std::max(hz, 1u); };
+      void refresh();
+
+      // called from the REPL thread, returning once the emulator has finished and rethrowing any error
+      void execute(std::string_view);
+      void reset();
+      void step();
+      void resume();
+      void breakpoint(unsigned int);
+      void profile(unsigned int);
+      std::string report(Profiler::VIEW = Profiler::SUMMARY);
+      void time(unsigned int);
+      void simulate(const std::vector<CacheLevel::Config>&);
+      std::string cacheReport();
+      void predict(const std::vector<Predictor::KIND>&);
+      std::string predictionReport();
+      void trace(std::unique_ptr<Trace>);
+      std::vector<Record> traced(size_t);
+      void saveTrace(std::string);
+
+      // called from the FLTK thread, returning straight away
       void run(std::string);
-      void start(std::vector<syntax::Node*>);
-      void run();
+      void run(std::string, std::vector<const syntax::Node*>);
       void stop();
-      void mode(MODE);
+
+      void shutdown();
   };
 }
 
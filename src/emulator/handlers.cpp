@@ -0,0 +1,223 @@
+#include "handlers.h"
+#include "windows/registers.h"
+#include "constants.h"
+#include <array>
+#include <bit>
+#include <utility>
+#include <variant>
+
+using namespace vm;
+
+namespace {
+
+  // Forms of the flexible second operand. The shifted forms take one entry per shift, so the shift is fixed
+  // when the handler is generated.
+  enum FORM {
+    IMMEDIATE,                                            // unrotated, so the carry flag is left alone
+    ROTATED_IMMEDIATE,                                    // the carry is the top bit of the rotated value
+    REGISTER,
+    SHIFTED_BY_IMMEDIATE,                                 // by 1 to 31, a shift by zero is decoded as REGISTER
+    SHIFTED_BY_REGISTER = SHIFTED_BY_IMMEDIATE + 4,
+    FORMS = SHIFTED_BY_REGISTER + 4
+  };
+
+  // The result of an operation before it is written back, with the carry and overflow it would set
+  struct Result {
+    uint32_t value;
+    bool carry;
+    bool overflow;
+  };
+
+  /**
+   * The barrel shifter for an amount from 1 to 31, which is all an immediate shift can hold.
+   */
+  template <syntax::SHIFT shift>
+  constexpr Result shiftByImmediate(uint32_t value, unsigned int amount) {
+    if constexpr (shift == syntax::LSL) return {value << amount, bool((value >> (32 - amount)) & 1), false};
+
+    bool carry = (value >> (amount - 1)) & 1;             // the last bit shifted out
+    if constexpr (shift == syntax::LSR) return {value >> amount, carry, false};
+    if constexpr (shift == syntax::ASR) return {uint32_t(int32_t(value) >> amount), carry, false};
+    if constexpr (shift == syntax::ROR) return {std::rotr(value, amount), carry, false};
+  }
+
+  /**
+   * The barrel shifter for an amount taken from the bottom byte of a register, which may also be zero or 32 and over.
+   */
+  template <syntax::SHIFT shift>
+  constexpr Result shiftByRegister(uint32_t value, unsigned int amount, bool carry) {
+    if (amount == 0) return {value, carry, false};
+
+    if constexpr (shift == syntax::ROR) {
+      if (amount % 32 == 0) return {value, bool(value >> 31), false};
+      return shiftByImmediate<shift>(value, amount % 32);
+    }
+    else {
+      if (amount < 32) return shiftByImmediate<shift>(value, amount);
+      if constexpr (shift == syntax::LSL) return {0, amount == 32 && (value & 1), false};
+      if constexpr (shift == syntax::LSR) return {0, amount == 32 && (value >> 31), false};
+      if constexpr (shift == syntax::ASR) return {uint32_t(int32_t(value) >> 31), bool(value >> 31), false};
+    }
+  }
+
+  static_assert(shiftByImmediate<syntax::LSL>(0x80000001, 1).value == 2 && shiftByImmediate<syntax::LSL>(0x80000001, 1).carry);
+  static_assert(shiftByImmediate<syntax::ASR>(0x80000000, 4).value == 0xf8000000);
+  static_assert(shiftByImmediate<syntax::ROR>(0x3, 1).value == 0x80000001 && shiftByImmediate<syntax::ROR>(0x3, 1).carry);
+  static_assert(shiftByRegister<syntax::LSR>(0x80000000, 32, false).value == 0 && shiftByRegister<syntax::LSR>(0x80000000, 32, false).carry);
+  static_assert(!shiftByRegister<syntax::LSL>(0xffffffff, 33, true).carry);
+
+  /**
+   * AddWithCarry from the ARM architecture reference manual. Every arithmetic operation is an addition, with
+   * subtraction adding the inverted operand plus one, so the carry is set when a subtraction does not borrow.
+   */
+  constexpr Result addWithCarry(uint32_t x, uint32_t y, bool carry) {
+    uint64_t unsignedSum = uint64_t(x) + y + carry;
+    int64_t signedSum = int64_t(int32_t(x)) + int32_t(y) + carry;
+    uint32_t value = uint32_t(unsignedSum);
+    return {value, unsignedSum != value, signedSum != int32_t(value)};
+  }
+
+  static_assert(addWithCarry(0xffffffff, 1, false).carry && !addWithCarry(0xffffffff, 1, false).overflow);
+  static_assert(addWithCarry(0x7fffffff, 1, false).overflow && !addWithCarry(0x7fffffff, 1, false).carry);
+  static_assert(addWithCarry(5, ~5u, true).value == 0 && addWithCarry(5, ~5u, true).carry);
+  static_assert(!addWithCarry(4, ~5u, true).carry);
+
+  template <FORM form>
+  Result operand(Registers& registers, const Decoded& decoded) {
+    bool carry = registers.flag(C);
+    if constexpr (form == IMMEDIATE) return {decoded.imm, carry, false};
+    else if constexpr (form == ROTATED_IMMEDIATE) return {decoded.imm, bool(decoded.imm >> 31), false};
+    else if constexpr (form == REGISTER) return {registers.value(decoded.Rm), carry, false};
+    else if constexpr (form < SHIFTED_BY_REGISTER)
+      return shiftByImmediate<syntax::SHIFT(form - SHIFTED_BY_IMMEDIATE)>(registers.value(decoded.Rm), decoded.imm);
+    else
+      return shiftByRegister<syntax::SHIFT(form - SHIFTED_BY_REGISTER)>(registers.value(decoded.Rm), registers.value(decoded.Rs) & 0xff, carry);
+  }
+
+  /**
+   * Executes a data processing instruction. Logical operations set the carry from the barrel shifter and leave
+   * the overflow alone, arithmetic operations set both from the addition.
+   */
+  template <syntax::OPERATION op, bool S, FORM form>
+  bool dataProcessing(Registers& registers, const Decoded& decoded) {
+    constexpr bool compare = op >= syntax::TST && op <= syntax::CMN;     // sets flags without writing a result
+
+    Result m = operand<form>(registers, decoded);
+    uint32_t n = registers.value(decoded.Rn);
+    bool carry = registers.flag(C);
+    bool overflow = registers.flag(V);
+
+    Result result;
+    if constexpr (op == syntax::AND || op == syntax::TST) result = {n & m.value, m.carry, overflow};
+    else if constexpr (op == syntax::EOR || op == syntax::TEQ) result = {n ^ m.value, m.carry, overflow};
+    else if constexpr (op == syntax::ORR) result = {n | m.value, m.carry, overflow};
+    else if constexpr (op == syntax::BIC) result = {n & ~m.value, m.carry, overflow};
+    else if constexpr (op == syntax::MOV) result = {m.value, m.carry, overflow};
+    else if constexpr (op == syntax::MVN) result = {~m.value, m.carry, overflow};
+    else if constexpr (op == syntax::ADD || op == syntax::CMN) result = addWithCarry(n, m.value, false);
+    else if constexpr (op == syntax::ADC) result = addWithCarry(n, m.value, carry);
+    else if constexpr (op == syntax::SUB || op == syntax::CMP) result = addWithCarry(n, ~m.value, true);
+    else if constexpr (op == syntax::SBC) result = addWithCarry(n, ~m.value, carry);
+    else if constexpr (op == syntax::RSB) result = addWithCarry(~n, m.value, true);
+    else if constexpr (op == syntax::RSC) result = addWithCarry(~n, m.value, carry);
+
+    if constexpr (!compare) registers[decoded.Rd] = result.value;
+    if constexpr (S) registers.setFlags(result.value >> 31, result.value == 0, result.carry, result.overflow);
+
+    if constexpr (compare) return false;
+    else return decoded.Rd == syntax::PC;
+  }
+
+  template <syntax::OPERATION op, bool toRegister>
+  bool branch(Registers& registers, const Decoded& decoded) {
+    uint32_t address = toRegister ? registers.value(decoded.Rm) : decoded.imm;
+    if constexpr (op == syntax::BL) registers[syntax::LR] = registers.value(syntax::PC) + 32;
+    registers[syntax::PC] = address;
+    return true;
+  }
+
+  bool nop(Registers&, const Decoded&) {
+    return false;
+  }
+
+  template <size_t... i>
+  constexpr std::array<Handler, sizeof...(i)> generate(std::index_sequence<i...>) {
+    return {&dataProcessing<syntax::OPERATION(i / (2 * FORMS)), bool(i / FORMS % 2), FORM(i % FORMS)>...};
+  }
+
+  // every data processing handler, indexed by operation, then by whether it sets flags, then by operand form
+  constexpr auto handlers = generate(std::make_index_sequence<16 * 2 * FORMS>());
+
+  constexpr Handler branches[3][2] = {
+    { &branch<syntax::B, false>,  &branch<syntax::B, true>  },
+    { &branch<syntax::BL, false>, &branch<syntax::BL, true> },
+    { &branch<syntax::BX, false>, &branch<syntax::BX, true> }
+  };
+
+  Handler handler(syntax::OPERATION op, bool S, FORM form) {
+    return handlers[(op * 2 + S) * FORMS + form];
+  }
+
+  FORM decode(const syntax::FlexOperand& flex, Decoded& decoded) {
+    if (flex.isImm()) {
+      decoded.imm = std::rotr(uint32_t(std::get<int>(flex.Rm())), flex.immShift());
+      return flex.immShift() ? ROTATED_IMMEDIATE : IMMEDIATE;
+    }
+
+    decoded.Rm = std::get<syntax::REGISTER>(flex.Rm());
+    if (flex.shiftedByReg()) {
+      decoded.Rs = std::get<syntax::REGISTER>(flex.Rs());
+      return FORM(SHIFTED_BY_REGISTER + int(flex.shift()));
+    }
+    if (flex.shiftedByImm() && std::get<int>(flex.Rs()) != 0) {
+      decoded.imm = std::get<int>(flex.Rs());
+      return FORM(SHIFTED_BY_IMMEDIATE + int(flex.shift()));
+    }
+    return REGISTER;
+  }
+}
+
+/**
+ * Picks the handler for an instruction and pulls out the operands it needs. Shifts are moves of a shifted
+ * register, as they are on the processor.
+ */
+Decoded vm::predecode(const syntax::InstructionNode& instruction) {
+  Decoded decoded;
+  decoded.cond = instruction.cond();
+
+  if (auto node = dynamic_cast<const syntax::BiOperandNode*>(&instruction)) {
+    bool compare = node->op() >= syntax::TST && node->op() <= syntax::CMN;
+    (compare ? decoded.Rn : decoded.Rd) = node->Rd();                   // comparisons have a first operand, not a destination
+    decoded.handler = handler(node->op(), node->setFlags(), decode(node->flex(), decoded));
+  }
+  else if (auto node = dynamic_cast<const syntax::TriOperandNode*>(&instruction)) {
+    decoded.Rd = node->Rd();
+    decoded.Rn = node->Rn();
+    decoded.handler = handler(node->op(), node->setFlags(), decode(node->flex(), decoded));
+  }
+  else if (auto node = dynamic_cast<const syntax::ShiftNode*>(&instruction)) {
+    decoded.Rd = node->Rd();
+    decoded.Rm = node->Rn();
+
+    FORM form = REGISTER;
+    std::variant<std::monostate, syntax::REGISTER, int> by = node->Rs();
+    if (by.index() == 1) {
+      decoded.Rs = std::get<syntax::REGISTER>(by);
+      form = FORM(SHIFTED_BY_REGISTER + int(node->shift()));
+    }
+    else if (std::get<int>(by) != 0) {
+      decoded.imm = std::get<int>(by);
+      form = FORM(SHIFTED_BY_IMMEDIATE + int(node->shift()));
+    }
+    decoded.handler = handler(syntax::MOV, node->setFlags(), form);
+  }
+  else if (auto node = dynamic_cast<const syntax::BranchNode*>(&instruction)) {
+    if (node->toLabel()) decoded.imm = node->address();
+    else decoded.Rm = std::get<syntax::REGISTER>(std::get<2>(node->unpack()));
+    decoded.handler = branches[node->op() - syntax::B][!node->toLabel()];
+    decoded.branch = true;
+  }
+  else decoded.handler = &nop;
+
+  return decoded;
+}
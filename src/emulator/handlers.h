@@ -0,0 +1,36 @@
+/**
+ * @file handlers.h
+ * Instructions are predecoded once, before a program runs, into a handler and the operands it needs. Handlers
+ * are generated from templates for every combination of operation, flag setting and operand form, so that
+ * executing an instruction is a single indirect call with nothing left to decide about the instruction itself.
+ */
+
+#ifndef IRISC_HANDLERS_H
+#define IRISC_HANDLERS_H
+
+#include <cstdint>
+#include "../parser/syntax.h"
+
+namespace vm {
+
+  class Registers;
+  struct Decoded;
+
+  // Executes a decoded instruction whose condition has passed, returning true if it wrote to the PC
+  using Handler = bool (*)(Registers&, const Decoded&);
+
+  struct Decoded {
+    Handler handler = nullptr;
+    syntax::CONDITION cond = syntax::AL;
+    uint8_t Rd = 0;
+    uint8_t Rn = 0;
+    uint8_t Rm = 0;
+    uint8_t Rs = 0;
+    bool branch = false;                              // B, BL or BX, which the Machine Code window doesn't show
+    uint32_t imm = 0;                                 // the immediate operand, an immediate shift amount or a branch address
+  };
+
+  Decoded predecode(const syntax::InstructionNode&);
+}
+
+#endif //IRISC_HANDLERS_H
@@ -0,0 +1,185 @@
+/**
+ * @file hierarchy.cpp
+ */
+
+#include "hierarchy.h"
+#include "windows/memory.h"
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+using namespace vm;
+
+/**
+ * Builds an empty cache. Every size is a power of two so that an address splits into tag, set and offset
+ * with shifts and masks alone.
+ */
+CacheLevel::CacheLevel(const Config& config) : _config(config) {
+  if (!std::has_single_bit(config.size) || !std::has_single_bit(config.line) || !std::has_single_bit(config.ways))
+    throw std::invalid_argument("Cache sizes, line sizes and associativities must be powers of two.");
+  if (config.line < 4) throw std::invalid_argument("Cache lines must hold at least one word.");
+  if (config.ways > 64) throw std::invalid_argument("Caches can be at most 64-way associative.");
+  uint64_t bytesPerSet = uint64_t(config.line) * config.ways;                   // wider than any size, so it cannot wrap
+  if (config.size < bytesPerSet) throw std::invalid_argument("A cache must be large enough for one line in every way.");
+
+  uint32_t sets = uint32_t(config.size / bytesPerSet);
+  offsetBits = std::countr_zero(config.line);
+  setMask = sets - 1;
+  tags.resize(config.size / config.line);
+  if (config.policy == LRU) used.resize(tags.size());
+  else trees.resize(sets);
+}
+
+/**
+ * Looks up an address, filling its line on a miss. Returns true on a hit.
+ */
+bool CacheLevel::access(uint32_t address) {
+  uint32_t block = address >> offsetBits;
+  uint32_t set = block & setMask;
+  uint64_t tag = uint64_t(block >> std::popcount(setMask)) + 1;
+  uint64_t* ways = &tags[size_t(set) * _config.ways];
+
+  for (unsigned int way = 0; way < _config.ways; way++) {
+    if (ways[way] == tag) {
+      _hits++;
+      touch(set, way);
+      return true;
+    }
+  }
+
+  _misses++;
+  unsigned int way = victim(set);
+  ways[way] = tag;
+  touch(set, way);
+  return false;
+}
+
+/**
+ * The way to replace in a set: an empty one if there is any, otherwise the one the policy picks.
+ */
+unsigned int CacheLevel::victim(uint32_t set) const {
+  size_t first = size_t(set) * _config.ways;
+  for (unsigned int way = 0; way < _config.ways; way++) {
+    if (tags[first + way] == 0) return way;
+  }
+
+  if (_config.policy == LRU) return std::min_element(used.begin() + first, used.begin() + first + _config.ways) - (used.begin() + first);
+
+  // follow the tree from the root, each bit pointing to the half used less recently
+  unsigned int node = 1;
+  while (node < _config.ways) node = node * 2 + ((trees[set] >> node) & 1);
+  return node - _config.ways;
+}
+
+/**
+ * Marks a way as the most recently used in its set.
+ */
+void CacheLevel::touch(uint32_t set, unsigned int way) {
+  if (_config.policy == LRU) {
+    used[size_t(set) * _config.ways + way] = ++clock;
+    return;
+  }
+
+  // point every node on the path to the way at the other half
+  unsigned int node = way + _config.ways;
+  while (node > 1) {
+    unsigned int parent = node / 2;
+    uint64_t away = uint64_t(!(node & 1)) << parent;
+    trees[set] = (trees[set] & ~(uint64_t(1) << parent)) | away;
+    node = parent;
+  }
+}
+
+void CacheLevel::clear() {
+  std::fill(tags.begin(), tags.end(), 0);
+  std::fill(used.begin(), used.end(), 0);
+  std::fill(trees.begin(), trees.end(), 0);
+  clock = _hits = _misses = 0;
+}
+
+CacheHierarchy::CacheHierarchy(const std::vector<CacheLevel::Config>& configs) {
+  if (configs.empty() || configs.size() > 2) throw std::invalid_argument("Only one or two levels of cache can be simulated.");
+  for (const CacheLevel::Config& config : configs) levels.emplace_back(config);
+}
+
+/**
+ * Empties every level and clears the counts for a new run of a program.
+ */
+void CacheHierarchy::reset(const Image& image) {
+  for (CacheLevel& level : levels) level.clear();
+  accesses.assign(image.text.size(), 0);
+  misses.assign(levels.size(), std::vector<uint64_t>(image.text.size(), 0));
+}
+
+/**
+ * Passes an access made by an instruction down the levels until one of them hits.
+ */
+void CacheHierarchy::access(uint32_t address, size_t site) {
+  accesses[site]++;
+  for (size_t level = 0; level < levels.size(); level++) {
+    if (levels[level].access(address)) return;
+    misses[level][site]++;
+  }
+}
+
+/**
+ * A report of the hits and misses at each level, then of the misses made by each instruction and under each
+ * label, the most first. Misses at a level are also accesses to the level below it. Until loads and stores are
+ * executed, the only accesses are instruction fetches.
+ */
+std::string CacheHierarchy::report(const Image& image) const {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1);
+
+  out << "Instruction fetches only: loads and stores are not simulated yet.\n\n";
+  out << std::setw(6) << "level" << std::setw(10) << "size" << std::setw(6) << "line" << std::setw(6) << "ways" << std::setw(8) << "policy"
+      << std::setw(12) << "hits" << std::setw(12) << "misses" << std::setw(8) << "miss %" << '\n';
+  for (size_t i = 0; i < levels.size(); i++) {
+    const CacheLevel& level = levels[i];
+    uint64_t total = level.hits() + level.misses();
+    out << std::setw(5) << "L" << i + 1 << std::setw(10) << level.config().size << std::setw(6) << level.config().line
+        << std::setw(6) << level.config().ways << std::setw(8) << (level.config().policy == CacheLevel::LRU ? "lru" : "plru")
+        << std::setw(12) << level.hits() << std::setw(12) << level.misses()
+        << std::setw(8) << (total ? 100.0 * level.misses() / total : 0.0) << '\n';
+  }
+
+  size_t size = std::min(image.text.size(), accesses.size());
+  std::vector<size_t> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return misses[0][a] > misses[0][b]; });
+
+  out << '\n' << std::setw(10) << "fetches";
+  for (size_t i = 0; i < levels.size(); i++) out << std::setw(9) << "L" << i + 1 << " misses";
+  out << std::setw(6) << "line" << "  instruction\n";
+  for (size_t i : order) {
+    if (misses[0][i] == 0) break;
+    out << std::setw(10) << accesses[i];
+    for (size_t level = 0; level < levels.size(); level++) out << std::setw(17) << misses[level][i];
+    out << std::setw(6) << image.text[i]->statement()[0].lineNumber() << "  " << image.text[i]->toString() << '\n';
+  }
+
+  std::vector<lexer::Symbol> owners = image.owners();
+  std::vector<std::pair<lexer::Symbol, std::vector<uint64_t>>> labels;           // fetches, then misses per level
+  for (size_t i = 0; i < size; i++) {
+    auto label = std::find_if(labels.begin(), labels.end(), [&](auto const& l) { return l.first == owners[i]; });
+    if (label == labels.end()) label = labels.insert(label, {owners[i], std::vector<uint64_t>(levels.size() + 1)});
+    label->second[0] += accesses[i];
+    for (size_t level = 0; level < levels.size(); level++) label->second[level + 1] += misses[level][i];
+  }
+  std::stable_sort(labels.begin(), labels.end(), [](auto const& a, auto const& b) { return a.second[1] > b.second[1]; });
+
+  out << '\n' << std::setw(10) << "fetches";
+  for (size_t i = 0; i < levels.size(); i++) out << std::setw(9) << "L" << i + 1 << " misses";
+  out << "  label\n";
+  for (auto const& [label, counts] : labels) {
+    if (counts[0] == 0) continue;
+    out << std::setw(10) << counts[0];
+    for (size_t level = 0; level < levels.size(); level++) out << std::setw(17) << counts[level + 1];
+    out << "  " << (label == lexer::Symbol{} ? "(no label)" : lexer::name(label)) << '\n';
+  }
+
+  return out.str();
+}
@@ -0,0 +1,68 @@
+/**
+ * @file hierarchy.h
+ * Simulates one or two levels of set associative cache in front of guest memory, counting the hits and misses
+ * of every access so that the effect of access order and stride on a program can be measured. Only the tags are
+ * simulated; the data itself stays in memory.
+ */
+
+#ifndef IRISC_HIERARCHY_H
+#define IRISC_HIERARCHY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+  struct Image;
+
+  class CacheLevel {
+    public:
+      enum POLICY { LRU, PLRU };
+
+      // Sizes are in bytes and must be powers of two
+      struct Config {
+        uint32_t size;
+        uint32_t line;
+        uint32_t ways;
+        POLICY policy = LRU;
+      };
+
+      CacheLevel(const Config&);
+      bool access(uint32_t address);
+      void clear();
+      const Config& config() const { return _config; };
+      uint64_t hits() const { return _hits; };
+      uint64_t misses() const { return _misses; };
+
+    private:
+      Config _config;
+      unsigned int offsetBits;                      // bits of an address within a line
+      uint32_t setMask;                             // the set index once the offset is shifted out
+      std::vector<uint64_t> tags;                   // ways per set, the tag plus one so that 0 is an empty line
+      std::vector<uint64_t> used;                   // LRU: when each line was last used
+      std::vector<uint64_t> trees;                  // PLRU: a tree of bits per set pointing away from recent ways
+      uint64_t clock = 0;
+      uint64_t _hits = 0;
+      uint64_t _misses = 0;
+
+      unsigned int victim(uint32_t set) const;
+      void touch(uint32_t set, unsigned int way);
+  };
+
+  class CacheHierarchy {
+    private:
+      std::vector<CacheLevel> levels;               // the first level is the one closest to the processor
+      std::vector<uint64_t> accesses;               // accesses made by each instruction
+      std::vector<std::vector<uint64_t>> misses;    // misses by each instruction, per level
+
+    public:
+      CacheHierarchy(const std::vector<CacheLevel::Config>&);
+      void reset(const Image&);
+      void access(uint32_t address, size_t site);
+      void fetch(uint32_t address, size_t index) { access(address, index); };     // an instruction at a byte address
+      std::string report(const Image&) const;
+  };
+}
+
+#endif //IRISC_HIERARCHY_H
@@ -0,0 +1,156 @@
+/**
+ * @file predictor.cpp
+ */
+
+#include "predictor.h"
+#include "windows/memory.h"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+using namespace vm;
+
+std::unique_ptr<Predictor> Predictor::create(KIND kind) {
+  switch (kind) {
+    case STATIC: return std::make_unique<StaticPredictor>();
+    case BIMODAL: return std::make_unique<BimodalPredictor>();
+    case GSHARE: return std::make_unique<GsharePredictor>();
+  }
+  return nullptr;
+}
+
+void BimodalPredictor::update(size_t site, bool taken) {
+  uint8_t& counter = counters[site % entries];
+  if (taken && counter < 3) counter++;
+  else if (!taken && counter > 0) counter--;
+}
+
+void GsharePredictor::update(size_t site, bool taken) {
+  uint8_t& counter = counters[(site ^ history) % entries];
+  if (taken && counter < 3) counter++;
+  else if (!taken && counter > 0) counter--;
+  history = ((history << 1) | taken) & ((1 << historyBits) - 1);
+}
+
+Predictors::Predictors(const std::vector<Predictor::KIND>& kinds) {
+  if (kinds.empty()) throw std::invalid_argument("Expected at least one branch predictor.");
+  for (Predictor::KIND kind : kinds) predictors.push_back(Predictor::create(kind));
+}
+
+/**
+ * Forgets everything the predictors have learned and works out what kind of branch, if any, each instruction
+ * of a program is.
+ */
+void Predictors::reset(const Image& image) {
+  for (auto& predictor : predictors) predictor->clear();
+
+  size_t size = image.text.size();
+  sites.assign(size, NONE);
+  backward.assign(size, false);
+  executions.assign(size, 0);
+  misses.assign(predictors.size() + 1, std::vector<uint64_t>(size, 0));
+  returns.clear();
+  returned = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    const syntax::InstructionNode* instruction = image.text[i];
+    uint8_t site = NONE;
+
+    if (auto branch = dynamic_cast<const syntax::BranchNode*>(instruction)) {
+      if (branch->op() == syntax::BL) site |= CALL;
+      if (branch->toLabel()) {
+        site |= DIRECT;
+        auto label = image.labels.find(branch->label());
+        backward[i] = label != image.labels.end() && label->second <= i;
+      }
+      else site |= std::get<syntax::REGISTER>(std::get<2>(branch->unpack())) == syntax::LR ? RETURN : INDIRECT;
+    }
+    else if (auto move = dynamic_cast<const syntax::BiOperandNode*>(instruction)) {
+      const syntax::FlexOperand& flex = move->flex();
+      if (move->op() == syntax::MOV && move->Rd() == syntax::PC && flex.isReg() && !flex.shifted() && std::get<syntax::REGISTER>(flex.Rm()) == syntax::LR) site |= RETURN;
+    }
+
+    if (site != NONE && instruction->cond() != syntax::AL) site |= CONDITIONAL;
+    sites[i] = site;
+  }
+}
+
+/**
+ * Shows every predictor the outcome of an instruction, and says whether it was mispredicted: the first predictor
+ * guessed the direction of a conditional branch wrongly, or the return address stack the target of a return.
+ * Redirecting the fetch after a taken branch costs the same whether or not it was predicted, so that is left to
+ * the timing model.
+ */
+bool Predictors::resolve(size_t site, bool executed, size_t target) {
+  uint8_t kind = sites[site];
+  if (kind == NONE) return false;
+  executions[site]++;
+
+  bool mispredicted = false;
+  if (kind & CONDITIONAL) {
+    for (size_t i = 0; i < predictors.size(); i++) {
+      bool wrong = predictors[i]->predict(site, backward[site]) != executed;
+      predictors[i]->update(site, executed);
+      if (wrong) misses[i][site]++;
+      if (i == 0) mispredicted = wrong;
+    }
+  }
+  if (!executed) return mispredicted;
+
+  if (kind & RETURN) {
+    bool wrong = returns.empty() || returns.back() != target;
+    if (!returns.empty()) returns.pop_back();
+    if (wrong) misses.back()[site]++;
+    returned++;
+    mispredicted |= wrong;
+  }
+  if (kind & CALL) {
+    if (returns.size() == depth) returns.erase(returns.begin());            // the oldest entry is overwritten
+    returns.push_back(site + 1);
+  }
+  return mispredicted;
+}
+
+/**
+ * A comparison of the predictors over every conditional branch, then of each conditional branch and return
+ * under every predictor, the most mispredicted first.
+ */
+std::string Predictors::report(const Image& image) const {
+  size_t size = std::min(image.text.size(), executions.size());
+  uint64_t conditionals = 0;
+  for (size_t i = 0; i < size; i++) if (sites[i] & CONDITIONAL) conditionals += executions[i];
+
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1);
+
+  out << std::setw(10) << "predictor" << std::setw(12) << "branches" << std::setw(12) << "mispredicts" << std::setw(10) << "accuracy" << '\n';
+  auto row = [&](std::string_view name, uint64_t branches, const std::vector<uint64_t>& wrong) {
+    uint64_t total = std::accumulate(wrong.begin(), wrong.end(), uint64_t(0));
+    out << std::setw(10) << name << std::setw(12) << branches << std::setw(12) << total
+        << std::setw(9) << (branches ? 100.0 * (branches - total) / branches : 100.0) << "%\n";
+  };
+  for (size_t i = 0; i < predictors.size(); i++) row(predictors[i]->name(), conditionals, misses[i]);
+  row("returns", returned, misses.back());
+
+  std::vector<size_t> order;
+  for (size_t i = 0; i < size; i++) if ((sites[i] & (CONDITIONAL | RETURN)) && executions[i]) order.push_back(i);
+  auto wrong = [this](size_t site) {
+    uint64_t total = 0;
+    for (auto const& counts : misses) total += counts[site];
+    return total;
+  };
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return wrong(a) > wrong(b); });
+
+  out << '\n' << std::setw(10) << "reached";
+  for (auto const& predictor : predictors) out << std::setw(10) << predictor->name();
+  out << std::setw(10) << "returns" << std::setw(6) << "line" << "  instruction\n";
+  for (size_t i : order) {
+    out << std::setw(10) << executions[i];
+    for (auto const& counts : misses) out << std::setw(10) << counts[i];
+    out << std::setw(6) << image.text[i]->statement()[0].lineNumber() << "  " << image.text[i]->toString() << '\n';
+  }
+
+  return out.str();
+}
@@ -0,0 +1,109 @@
+/**
+ * @file predictor.h
+ * Simulates branch predictors alongside a running program. Every predictor sees every branch in the same run,
+ * so that several of them can be compared on one program in one pass. Each counts its mispredictions per branch,
+ * and the first one decides which branches pay the misprediction penalty when cycles are being estimated.
+ */
+
+#ifndef IRISC_PREDICTOR_H
+#define IRISC_PREDICTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../lookup.h"
+
+namespace vm {
+
+  struct Image;
+
+  /**
+   * Guesses whether a conditional branch will be taken before its condition is known, and learns from the outcome.
+   */
+  class Predictor {
+    public:
+      enum KIND { STATIC, BIMODAL, GSHARE };
+
+      virtual ~Predictor() = default;
+      virtual std::string_view name() const = 0;
+      virtual bool predict(size_t site, bool backward) const = 0;
+      virtual void update(size_t site, bool taken) {};
+      virtual void clear() {};
+
+      static std::unique_ptr<Predictor> create(KIND);
+  };
+
+  inline constexpr auto predictorMap = std::to_array<std::pair<std::string_view, Predictor::KIND>>({
+    {"static", Predictor::STATIC}, {"bimodal", Predictor::BIMODAL}, {"gshare", Predictor::GSHARE}
+  });
+
+  // Backward taken, forward not taken, which gets loops right without remembering anything
+  class StaticPredictor : public Predictor {
+    public:
+      std::string_view name() const override { return "static"; };
+      bool predict(size_t, bool backward) const override { return backward; };
+  };
+
+  // A two bit saturating counter per branch, indexed by the low bits of its address
+  class BimodalPredictor : public Predictor {
+    public:
+      static constexpr size_t entries = 1024;
+
+      std::string_view name() const override { return "bimodal"; };
+      bool predict(size_t site, bool) const override { return counters[site % entries] >= 2; };
+      void update(size_t site, bool taken) override;
+      void clear() override { counters.assign(entries, 1); };
+
+    protected:
+      std::vector<uint8_t> counters = std::vector<uint8_t>(entries, 1);     // start weakly not taken
+  };
+
+  // Two bit counters indexed by the branch address XORed with the outcomes of the most recent branches
+  class GsharePredictor : public BimodalPredictor {
+    public:
+      static constexpr unsigned int historyBits = 10;
+
+      std::string_view name() const override { return "gshare"; };
+      bool predict(size_t site, bool) const override { return counters[(site ^ history) % entries] >= 2; };
+      void update(size_t site, bool taken) override;
+      void clear() override { BimodalPredictor::clear(); history = 0; };
+
+    private:
+      uint32_t history = 0;
+  };
+
+  /**
+   * Every predictor being compared, with a return address stack which predicts where each return goes.
+   */
+  class Predictors {
+    private:
+      enum SITE : uint8_t {
+        NONE = 0,
+        CONDITIONAL = 1 << 0,                       // a branch whose direction has to be predicted
+        CALL = 1 << 1,                              // a BL, which pushes its return address
+        RETURN = 1 << 2,                            // a BX or MOV to the PC from the LR
+        INDIRECT = 1 << 3,                          // any other branch to a register, whose target isn't known early
+        DIRECT = 1 << 4                             // a branch to a label, whose target is known once it is decoded
+      };
+
+      static constexpr size_t depth = 8;            // entries in the return address stack
+
+      std::vector<std::unique_ptr<Predictor>> predictors;
+      std::vector<uint8_t> sites;                   // SITE flags for each instruction
+      std::vector<bool> backward;                   // whether each branch to a label goes backwards
+      std::vector<uint64_t> executions;             // times each branch was reached
+      std::vector<std::vector<uint64_t>> misses;    // mispredictions at each branch, per predictor, then the stack
+      std::vector<size_t> returns;                  // the return address stack, innermost last
+      uint64_t returned = 0;                        // returns predicted by the stack
+
+    public:
+      Predictors(const std::vector<Predictor::KIND>&);
+      void reset(const Image&);
+      bool resolve(size_t site, bool executed, size_t target);
+      std::string report(const Image&) const;
+  };
+}
+
+#endif //IRISC_PREDICTOR_H
@@ -0,0 +1,267 @@
+/**
+ * @file profiler.cpp
+ */
+
+#include "profiler.h"
+#include "windows/memory.h"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+using namespace vm;
+
+namespace {
+  std::string_view nameOf(lexer::Symbol function) {
+    return function == lexer::Symbol{} ? "(no label)" : lexer::name(function);
+  }
+}
+
+/**
+ * Clears the counts for a new run of a program starting at the given instruction. Which label each instruction
+ * falls under, and which instructions are calls, are worked out here once rather than as it runs.
+ */
+void Profiler::reset(const Image& image, size_t entry) {
+  size_t size = image.text.size();
+  counts.assign(size * 2, 0);
+
+  owners = image.owners();
+  calls.assign(size, false);
+  for (size_t i = 0; i < size; i++) {
+    auto branch = dynamic_cast<const syntax::BranchNode*>(image.text[i]);
+    calls[i] = branch && branch->op() == syntax::BL;
+  }
+
+  frames.assign(1, Frame{entry < size ? owners[entry] : lexer::Symbol{}, 0});
+  callees.clear();
+  current = 0;
+  returns.clear();
+  countdown = period;
+}
+
+/**
+ * Follows a branch taken from one instruction to another on the shadow call stack. A call enters the function
+ * labelled at its target. Any branch back to the instruction after the innermost call returns from it, so a
+ * function may return through the LR or through whichever register it kept the LR in.
+ */
+void Profiler::branch(size_t from, size_t to) {
+  if (calls[from]) {
+    lexer::Symbol function = to < owners.size() ? owners[to] : lexer::Symbol{};
+    auto [callee, added] = callees.try_emplace((uint64_t(current) << 32) | uint32_t(function), frames.size());
+    if (added) frames.push_back({function, current});
+    current = callee->second;
+    returns.push_back(from + 1);
+  }
+  else if (!returns.empty() && to == returns.back()) {
+    current = frames[current].parent;
+    returns.pop_back();
+  }
+}
+
+/**
+ * The functions on the call stack ending at a frame, outermost first.
+ */
+std::vector<lexer::Symbol> Profiler::stack(uint32_t frame) const {
+  std::vector<lexer::Symbol> functions {frames[frame].function};
+  for (; frame != 0; frame = frames[frame].parent) functions.push_back(frames[frames[frame].parent].function);
+  std::reverse(functions.begin(), functions.end());
+  return functions;
+}
+
+/**
+ * Sums the samples under every frame. A frame is always added after its parent, so one pass from the end
+ * covers every subtree, however deep the calls went.
+ */
+Profiler::CallTree Profiler::callTree() const {
+  CallTree tree { std::vector<uint64_t>(frames.size()), std::vector<std::vector<uint32_t>>(frames.size()) };
+  for (uint32_t frame = frames.size() - 1; frame > 0; frame--) {
+    tree.inclusive[frame] += frames[frame].samples;
+    tree.inclusive[frames[frame].parent] += tree.inclusive[frame];
+    tree.children[frames[frame].parent].push_back(frame);
+  }
+  if (!frames.empty()) tree.inclusive[0] += frames[0].samples;
+  return tree;
+}
+
+/**
+ * The number of times each source line was reached, indexed by line number. Every instruction costs a cycle
+ * whether its condition passed or not.
+ */
+std::vector<uint64_t> Profiler::lines(const Image& image) const {
+  std::vector<uint64_t> lines;
+  for (size_t i = 0; i < image.text.size() && i * 2 < counts.size(); i++) {
+    unsigned int line = image.text[i]->statement()[0].lineNumber();
+    if (line >= lines.size()) lines.resize(line + 1);
+    lines[line] += executed(i) + skipped(i);
+  }
+  return lines;
+}
+
+std::string Profiler::report(VIEW view, const Image& image) const {
+  switch (view) {
+    case FOLDED: return folded();
+    case TREE: return tree();
+    default: return summary(image);
+  }
+}
+
+/**
+ * A report of the instructions which were reached, most often first, then the cycles spent under each label,
+ * then the samples taken in each function. Conditional instructions also show how often their condition passed
+ * and failed, which for a branch is how often it was taken. A function's exclusive samples were taken in its
+ * own code; its inclusive samples also count the functions it called, once however deeply it recursed.
+ */
+std::string Profiler::summary(const Image& image) const {
+  size_t size = std::min(image.text.size(), counts.size() / 2);
+  uint64_t total = std::accumulate(counts.begin(), counts.end(), uint64_t(0));
+
+  std::vector<size_t> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return executed(a) + skipped(a) > executed(b) + skipped(b);
+  });
+
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1);
+  out << total << " cycles\n\n";
+  out << std::setw(10) << "cycles" << std::setw(8) << "%" << std::setw(6) << "line" << "  instruction\n";
+  for (size_t i : order) {
+    uint64_t cycles = executed(i) + skipped(i);
+    if (cycles == 0) break;
+
+    const syntax::InstructionNode* node = image.text[i];
+    out << std::setw(10) << cycles << std::setw(8) << 100.0 * cycles / total
+        << std::setw(6) << node->statement()[0].lineNumber() << "  " << node->toString();
+    if (node->cond() != syntax::AL) out << "  (" << executed(i) << " taken, " << skipped(i) << " not taken)";
+    out << '\n';
+  }
+
+  std::vector<std::pair<lexer::Symbol, uint64_t>> labels;
+  for (size_t i = 0; i < size; i++) {
+    auto label = std::find_if(labels.begin(), labels.end(), [&](auto const& l) { return l.first == owners[i]; });
+    if (label == labels.end()) label = labels.insert(label, {owners[i], 0});
+    label->second += executed(i) + skipped(i);
+  }
+  std::stable_sort(labels.begin(), labels.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+
+  out << '\n' << std::setw(10) << "cycles" << std::setw(8) << "%" << "  label\n";
+  for (auto const& [label, cycles] : labels) {
+    if (cycles == 0) break;
+    out << std::setw(10) << cycles << std::setw(8) << 100.0 * cycles / total << "  " << nameOf(label) << '\n';
+  }
+
+  // samples per function, exclusive from the top of each stack and inclusive from anywhere on it
+  struct Function { lexer::Symbol name; uint64_t exclusive = 0; uint64_t inclusive = 0; };
+  std::vector<Function> functions;
+  auto find = [&](lexer::Symbol name) -> Function& {
+    auto function = std::find_if(functions.begin(), functions.end(), [&](const Function& f) { return f.name == name; });
+    return function == functions.end() ? functions.emplace_back(Function{name}) : *function;
+  };
+
+  uint64_t samples = 0;
+  for (const Frame& frame : frames) {
+    if (frame.samples == 0) continue;
+    samples += frame.samples;
+    find(frame.function).exclusive += frame.samples;
+  }
+
+  // a function's inclusive samples are everything under its outermost frame on each stack, so the tree is walked
+  // keeping count of how many times each function is already on the stack being walked
+  CallTree tree = callTree();
+  std::unordered_map<uint32_t, uint32_t> onStack;
+  std::vector<std::pair<uint32_t, bool>> pending {{0, false}};         // a frame, and whether it is being left
+  while (!frames.empty() && !pending.empty()) {
+    auto [frame, leaving] = pending.back();
+    pending.pop_back();
+
+    uint32_t& depth = onStack[uint32_t(frames[frame].function)];
+    if (leaving) {
+      depth--;
+      continue;
+    }
+    if (depth++ == 0 && tree.inclusive[frame]) find(frames[frame].function).inclusive += tree.inclusive[frame];
+
+    pending.push_back({frame, true});
+    for (uint32_t child : tree.children[frame]) pending.push_back({child, false});
+  }
+  std::stable_sort(functions.begin(), functions.end(), [](const Function& a, const Function& b) { return a.inclusive > b.inclusive; });
+
+  out << '\n' << std::setw(10) << "inclusive" << std::setw(8) << "%" << std::setw(10) << "exclusive" << std::setw(8) << "%" << "  function\n";
+  for (const Function& function : functions) {
+    out << std::setw(10) << function.inclusive << std::setw(8) << 100.0 * function.inclusive / samples
+        << std::setw(10) << function.exclusive << std::setw(8) << 100.0 * function.exclusive / samples
+        << "  " << nameOf(function.name) << '\n';
+  }
+
+  return out.str();
+}
+
+/**
+ * Every call stack which was sampled, one per line as its functions separated by semicolons and the number of
+ * samples. This is the folded format read by flamegraph.pl and speedscope. Stacks deeper than maxDepth are
+ * charged to their frame at that depth, under a final "...", so that runaway recursion stays readable.
+ */
+std::string Profiler::folded() const {
+  // a frame is always added after its parent, so one pass from the start finds the depth of every frame
+  std::vector<int> depths(frames.size());
+  std::vector<uint64_t> samples(frames.size());
+  std::vector<uint64_t> deeper(frames.size());
+  std::vector<uint32_t> cut(frames.size());                            // the frame at maxDepth above each deeper one
+  for (uint32_t frame = 0; frame < frames.size(); frame++) {
+    uint32_t parent = frames[frame].parent;
+    depths[frame] = frame ? depths[parent] + 1 : 0;
+    cut[frame] = depths[frame] <= maxDepth ? frame : depths[parent] == maxDepth ? parent : cut[parent];
+    if (cut[frame] == frame) samples[frame] += frames[frame].samples;
+    else deeper[cut[frame]] += frames[frame].samples;
+  }
+
+  std::ostringstream out;
+  for (uint32_t frame = 0; frame < frames.size(); frame++) {
+    if (samples[frame] == 0 && deeper[frame] == 0) continue;
+
+    std::string path;
+    for (lexer::Symbol function : stack(frame)) path.append(path.empty() ? "" : ";").append(nameOf(function));
+    if (samples[frame]) out << path << ' ' << samples[frame] << '\n';
+    if (deeper[frame]) out << path << ";... " << deeper[frame] << '\n';
+  }
+  return out.str();
+}
+
+/**
+ * The call tree drawn in text, so that it can be read as a flame graph on its side without any other tools.
+ * Each function is shown under its caller with its inclusive samples, the largest first. Calls nested deeper
+ * than maxDepth are summed into a single line.
+ */
+std::string Profiler::tree() const {
+  if (frames.empty()) return "";
+
+  CallTree tree = callTree();
+  std::vector<uint64_t>& inclusive = tree.inclusive;
+
+  // drawn from an explicit stack, with very deep calls cut short, so that runaway recursion can still be shown
+  std::ostringstream out;
+  std::vector<std::pair<uint32_t, int>> pending {{0, 0}};               // a frame, and its depth in the tree
+  while (!pending.empty()) {
+    auto [frame, depth] = pending.back();
+    pending.pop_back();
+    if (inclusive[frame] == 0) continue;
+
+    int width = inclusive[0] ? int(40 * inclusive[frame] / inclusive[0]) : 0;
+    out << std::string(width, '#') << std::string(41 - width, ' ') << std::string(depth * 2, ' ')
+        << nameOf(frames[frame].function) << " (" << inclusive[frame] << ")\n";
+
+    std::vector<uint32_t>& children = tree.children[frame];
+    if (inclusive[frame] == frames[frame].samples) continue;
+    if (depth == maxDepth) {
+      out << std::string(41 + (depth + 1) * 2, ' ') << "... deeper calls (" << inclusive[frame] - frames[frame].samples << ")\n";
+      continue;
+    }
+
+    std::stable_sort(children.begin(), children.end(), [&](uint32_t a, uint32_t b) { return inclusive[a] > inclusive[b]; });
+    for (auto child = children.rbegin(); child != children.rend(); child++) pending.push_back({*child, depth + 1});
+  }
+
+  return out.str();
+}
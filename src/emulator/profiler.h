@@ -0,0 +1,82 @@
+/**
+ * @file profiler.h
+ * Counts how often each instruction of a program runs, so that students can see where their program spends
+ * its time. Counts are kept by position in the text section and only turned into lines and labels when a
+ * report is asked for. Alongside them the profiler follows calls and returns on a shadow call stack, so that
+ * time can also be attributed to functions and drawn as a flame graph.
+ */
+
+#ifndef IRISC_PROFILER_H
+#define IRISC_PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../lexer/symbol.h"
+
+namespace vm {
+
+  struct Image;
+
+  class Profiler {
+    public:
+      enum VIEW { SUMMARY, FOLDED, TREE };
+
+    private:
+      // A node in the tree of every call stack seen, so that a stack is a single index however deep it is
+      struct Frame {
+        lexer::Symbol function;
+        uint32_t parent;
+        uint64_t samples = 0;
+      };
+
+      std::vector<uint64_t> counts;                   // two per instruction: condition failed, then condition passed
+      std::vector<lexer::Symbol> owners;              // the closest label above each instruction
+      std::vector<bool> calls;                        // whether each instruction is a BL
+      std::vector<Frame> frames;                      // frames[0] is the function the program starts in
+      std::unordered_map<uint64_t, uint32_t> callees; // a frame's child for a function, keyed by both
+      uint32_t current = 0;                           // the frame at the top of the call stack
+      std::vector<size_t> returns;                    // the instruction after each call on the stack, innermost last
+      uint32_t period = 1;                            // instructions between samples of the call stack
+      uint32_t countdown = 1;
+      static constexpr int maxDepth = 64;             // calls drawn by the tree before the rest are summed up
+
+      // The inclusive samples of every frame, and the children of each, for walking the tree of frames
+      struct CallTree {
+        std::vector<uint64_t> inclusive;
+        std::vector<std::vector<uint32_t>> children;
+      };
+
+      std::vector<lexer::Symbol> stack(uint32_t) const;
+      CallTree callTree() const;
+      std::string summary(const Image&) const;
+      std::string folded() const;
+      std::string tree() const;
+
+    public:
+      void reset(const Image&, size_t entry);
+      void clear() { counts.clear(); frames.clear(); };
+      void sample(uint32_t every) { period = countdown = every; };
+      bool empty() const { return counts.empty(); };
+      uint64_t executed(size_t index) const { return counts[index * 2 + 1]; };
+      uint64_t skipped(size_t index) const { return counts[index * 2]; };
+      std::vector<uint64_t> lines(const Image&) const;
+      std::string report(VIEW, const Image&) const;
+
+      /**
+       * Counts an instruction, and charges it to the current call stack if a sample is due.
+       */
+      void record(size_t index, bool executed) {
+        counts[index * 2 + executed]++;
+        if (--countdown == 0) {
+          countdown = period;
+          frames[current].samples++;
+        }
+      };
+
+      void branch(size_t from, size_t to);
+  };
+}
+
+#endif //IRISC_PROFILER_H
@@ -0,0 +1,79 @@
+/**
+ * @file snapshot.h
+ * A compact record of the machine state which the emulator thread publishes after every instruction, and a
+ * seqlock to publish it through so that any number of readers can take consistent copies without ever
+ * making the emulator wait.
+ */
+
+#ifndef IRISC_SNAPSHOT_H
+#define IRISC_SNAPSHOT_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace vm {
+
+  /**
+   * Everything an observer needs to show the machine without touching it. Guest memory is not included
+   * since nothing executed by the emulator writes to it yet.
+   */
+  struct State {
+    std::array<uint32_t, 16> registers {};
+    uint32_t cpsr = 0;                                    // NZCV in bits 31 to 28, as in the real register
+    uint16_t changed = 0;                                 // bit i is set if the last instruction wrote register i
+    bool flagged = false;                                 // set if the last instruction wrote the flags
+    bool running = false;
+    uint64_t steps = 0;                                   // instructions executed since the last run or reset
+    uint64_t cycles = 0;                                  // cycles they would have taken, if a timing model is in use
+  };
+
+  /**
+   * Single writer, many reader publication of a trivially copyable value. The writer makes the sequence odd
+   * while it copies the value in, and readers retry whenever they see an odd sequence or the sequence moves
+   * under them. The value is held as relaxed atomic words so that torn reads are retried rather than racy.
+   */
+  template <typename T>
+  class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    private:
+      static constexpr size_t words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+      alignas(64) std::atomic<uint64_t> sequence = 0;
+      std::array<std::atomic<uint64_t>, words> data {};
+
+    public:
+      void publish(const T& value) {
+        std::array<uint64_t, words> buffer {};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+
+        uint64_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < words; i++) data[i].store(buffer[i], std::memory_order_relaxed);
+        sequence.store(s + 2, std::memory_order_release);
+      }
+
+      T read() const {
+        std::array<uint64_t, words> buffer;
+        uint64_t before, after;
+
+        do {
+          before = sequence.load(std::memory_order_acquire);
+          for (size_t i = 0; i < words; i++) buffer[i] = data[i].load(std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_acquire);
+          after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        T value;
+        std::memcpy(&value, buffer.data(), sizeof(T));
+        return value;
+      }
+  };
+
+}
+
+#endif //IRISC_SNAPSHOT_H
@@ -0,0 +1,100 @@
+/**
+ * @file timing.cpp
+ */
+
+#include "timing.h"
+#include "windows/memory.h"
+#include <stdexcept>
+
+using namespace vm;
+
+namespace {
+  uint16_t bit(syntax::REGISTER reg) {
+    return uint16_t(1) << reg;
+  }
+
+  uint16_t reads(const syntax::FlexOperand& flex) {
+    uint16_t registers = 0;
+    if (flex.isReg()) registers |= bit(std::get<syntax::REGISTER>(flex.Rm()));
+    if (flex.shiftedByReg()) registers |= bit(std::get<syntax::REGISTER>(flex.Rs()));
+    return registers;
+  }
+}
+
+/**
+ * A model of one of the pipelines there are costs for.
+ */
+std::unique_ptr<TimingModel> TimingModel::pipeline(unsigned int stages) {
+  switch (stages) {
+    case 3: return std::make_unique<Pipeline>(Pipeline::threeStage);
+    case 5: return std::make_unique<Pipeline>(Pipeline::fiveStage);
+    default: throw std::invalid_argument("Only 3 and 5 stage pipelines can be modelled.");
+  }
+}
+
+/**
+ * Starts counting again from zero for a program, working out which registers each instruction reads and loads
+ * and how long it takes when nothing holds it up.
+ */
+void Pipeline::reset(const Image& image) {
+  _cycles = 0;
+  loading = 0;
+  timings.assign(image.text.size(), Timing{});
+
+  for (size_t i = 0; i < image.text.size(); i++) {
+    const syntax::InstructionNode* instruction = image.text[i];
+    Timing& timing = timings[i];
+
+    if (auto node = dynamic_cast<const syntax::BiOperandNode*>(instruction)) {
+      if (node->op() >= syntax::TST && node->op() <= syntax::CMN) timing.reads |= bit(node->Rd());
+      timing.reads |= reads(node->flex());
+      if (node->flex().shiftedByReg()) timing.cycles += costs.registerShift;
+    }
+    else if (auto node = dynamic_cast<const syntax::TriOperandNode*>(instruction)) {
+      timing.reads |= bit(node->Rn()) | reads(node->flex());
+      if (node->flex().shiftedByReg()) timing.cycles += costs.registerShift;
+    }
+    else if (auto node = dynamic_cast<const syntax::ShiftNode*>(instruction)) {
+      timing.reads |= bit(node->Rn());
+      if (node->Rs().index() == 1) {
+        timing.reads |= bit(std::get<syntax::REGISTER>(node->Rs()));
+        timing.cycles += costs.registerShift;
+      }
+    }
+    else if (auto node = dynamic_cast<const syntax::BranchNode*>(instruction)) {
+      if (!node->toLabel()) timing.reads |= bit(std::get<syntax::REGISTER>(std::get<2>(node->unpack())));
+    }
+    else if (instruction->op() == syntax::LDR || instruction->op() == syntax::STR) {
+      auto node = static_cast<const syntax::LoadStoreNode*>(instruction);
+      timing.reads |= bit(node->Rn());
+      if (instruction->op() == syntax::LDR) {
+        timing.loads = bit(node->Rd());
+        timing.cycles += costs.load;
+      }
+      else {
+        timing.reads |= bit(node->Rd());
+        timing.cycles += costs.store;
+      }
+    }
+  }
+}
+
+/**
+ * Charges an instruction as it leaves the pipeline. One skipped by its condition still takes a cycle to pass
+ * through, but nothing waits on it, unless it was a branch wrongly predicted to be taken. Taken branches always
+ * pay for the refill, since no pipeline modelled here has a branch target buffer to fetch their target early.
+ */
+void Pipeline::retire(size_t index, bool executed, bool branched, bool mispredicted) {
+  const Timing& timing = timings[index];
+  if (!executed) {
+    _cycles += 1 + (mispredicted ? costs.mispredict : 0);
+    loading = 0;
+    return;
+  }
+
+  _cycles += timing.cycles;
+  if (branched) _cycles += costs.branchTaken;
+  if (mispredicted) _cycles += costs.mispredict;
+  if (timing.reads & loading) _cycles += costs.loadUse;
+  loading = timing.loads;
+}
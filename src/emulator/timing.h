@@ -0,0 +1,80 @@
+/**
+ * @file timing.h
+ * Estimates how many cycles a program would take on a real processor. Instruction counts alone hide why one
+ * program is faster than another, so a timing model charges each instruction for what it costs the pipeline:
+ * refilling after a taken branch, waiting on a load, shifting by a register or being skipped by its condition.
+ */
+
+#ifndef IRISC_TIMING_H
+#define IRISC_TIMING_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace vm {
+
+  struct Image;
+
+  /**
+   * A model is told about every instruction as it retires, whether it wrote the PC, and whether branch predictors
+   * being simulated guessed it wrongly. Whatever a model needs to know about an instruction is worked out when the
+   * program is reset, so that retiring one is as cheap as possible.
+   */
+  class TimingModel {
+    public:
+      virtual ~TimingModel() = default;
+      virtual std::string_view name() const = 0;
+      virtual void reset(const Image&) = 0;
+      virtual void retire(size_t index, bool executed, bool branched, bool mispredicted) = 0;
+      uint64_t cycles() const { return _cycles; };
+
+      static std::unique_ptr<TimingModel> pipeline(unsigned int stages);
+
+    protected:
+      uint64_t _cycles = 0;
+  };
+
+  /**
+   * An in-order pipeline which issues an instruction every cycle unless something holds it up.
+   */
+  class Pipeline : public TimingModel {
+    public:
+      // The cycles each hold-up costs, on top of the one cycle every instruction takes
+      struct Costs {
+        std::string_view name;
+        uint8_t load;                               // extra cycles for a load
+        uint8_t store;                              // extra cycles for a store
+        uint8_t registerShift;                      // reading a third register for the shift amount
+        uint8_t branchTaken;                        // refilling the pipeline after a write to the PC, predicted or not
+        uint8_t loadUse;                            // an instruction waiting on the result of the load before it
+        uint8_t mispredict;                         // squashing work fetched down the wrong path, on top of any refill
+      };
+
+      // ARM7TDMI: fetch, decode, execute, with loads and stores taking extra execute cycles
+      static constexpr Costs threeStage { "3-stage pipeline", 2, 1, 1, 2, 0, 0 };
+      // ARM9TDMI: fetch, decode, execute, memory, write back, with the result of a load a cycle late
+      // fetch and decode speculatively past a predicted branch, which costs a cycle to undo when wrong
+      static constexpr Costs fiveStage { "5-stage pipeline", 0, 0, 1, 2, 1, 1 };
+
+      Pipeline(const Costs& costs) : costs(costs) {};
+      std::string_view name() const override { return costs.name; };
+      void reset(const Image&) override;
+      void retire(size_t index, bool executed, bool branched, bool mispredicted) override;
+
+    private:
+      // What the pipeline needs to know about an instruction
+      struct Timing {
+        uint16_t reads = 0;                         // bit i is set if the instruction reads register i
+        uint16_t loads = 0;                         // bit i is set if the instruction loads register i
+        uint8_t cycles = 1;                         // when nothing else holds it up
+      };
+
+      Costs costs;
+      std::vector<Timing> timings;
+      uint16_t loading = 0;                         // registers the last instruction loaded
+  };
+}
+
+#endif //IRISC_TIMING_H
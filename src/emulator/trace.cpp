@@ -0,0 +1,128 @@
+/**
+ * @file trace.cpp
+ */
+
+#include "trace.h"
+#include <algorithm>
+#include <bitset>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace vm;
+
+namespace {
+  std::runtime_error failure(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+  }
+}
+
+/**
+ * Traces into a ring buffer which keeps the given number of the most recent records.
+ */
+Trace::Trace(size_t capacity) : ring(std::max<size_t>(capacity, 1)) {
+  window = cursor = ring.data();
+  end = ring.data() + ring.size();
+}
+
+/**
+ * Traces into a file, replacing it if it exists. The file grows a chunk at a time, and is cut down to the
+ * records actually written when the trace ends.
+ */
+Trace::Trace(const std::string& path) {
+  file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file == -1) throw failure("Couldn't open the trace file '" + path + "'");
+
+  try { advance(); }
+  catch (...) {
+    ::close(file);
+    throw;
+  }
+  *reinterpret_cast<Header*>(cursor++) = Header();             // the header takes the first slot of the first chunk
+}
+
+Trace::~Trace() {
+  if (!toFile()) return;
+
+  if (window) munmap(window, chunk * sizeof(Record));
+  if (ftruncate(file, (written + 1) * sizeof(Record)) == -1) {}     // nothing to be done about it while closing
+  ::close(file);
+}
+
+/**
+ * Moves on to the next window once the current one is full. A ring buffer wraps around to its start; a file
+ * is extended by another chunk, which is mapped in place of the last one.
+ */
+void Trace::advance() {
+  if (!toFile()) {
+    cursor = window;
+    return;
+  }
+
+  size_t bytes = chunk * sizeof(Record);                        // a whole number of pages, so every chunk is aligned
+  if (window) munmap(window, bytes);
+  window = cursor = end = nullptr;                              // nothing is mapped if extending the file fails
+  if (ftruncate(file, (chunks + 1) * bytes) == -1) throw failure("Couldn't extend the trace file");
+
+  void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, chunks * bytes);
+  if (mapped == MAP_FAILED) throw failure("Couldn't map the trace file");
+
+  window = cursor = static_cast<Record*>(mapped);
+  end = window + chunk;
+  chunks++;
+}
+
+/**
+ * Up to the given number of the most recent records, oldest first. A file trace only has those of the chunk
+ * it is currently writing to hand.
+ */
+std::vector<Record> Trace::recent(size_t count) const {
+  if (toFile()) {
+    if (!window) return {};
+    Record* first = std::max(cursor - std::min<ptrdiff_t>(count, cursor - window), window + (chunks == 1));
+    return std::vector<Record>(first, cursor);
+  }
+
+  count = std::min<uint64_t>({count, written, ring.size()});
+  std::vector<Record> records;
+  records.reserve(count);
+  size_t next = cursor - window;
+  for (size_t i = 0; i < count; i++) records.push_back(ring[(next + ring.size() - count + i) % ring.size()]);
+  return records;
+}
+
+/**
+ * Writes records out as a trace file, e.g. to keep what is in a ring buffer.
+ */
+void Trace::save(const std::string& path, const std::vector<Record>& records) {
+  std::ofstream out(path, std::ios::binary);
+  Header header;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+  if (!out) throw std::runtime_error("Couldn't write the trace to '" + path + "'.");
+}
+
+/**
+ * A record as a line of text: the step, the PC and machine code, then what the instruction wrote and the
+ * flags afterwards.
+ */
+std::string Trace::format(const Record& record, uint64_t step) {
+  std::ostringstream out;
+  out << std::setw(10) << step << std::hex << std::setfill('0')
+      << "  " << std::setw(8) << record.pc << "  " << std::setw(8) << record.word << "  ";
+
+  if (!(record.flags & Record::EXECUTED)) out << "skipped        ";
+  else if (record.reg == Record::NONE) out << "               ";
+  else out << std::dec << std::setfill(' ') << std::left << std::setw(4) << ("r" + std::to_string(record.reg)) << std::right
+           << std::hex << std::setfill('0') << "0x" << std::setw(8) << record.value << ' ';
+
+  out << " nzcv " << std::bitset<4>(record.flags >> 4);
+  if (record.flags & Record::MEMORY) out << "  [0x" << std::setw(8) << record.address << "] 0x" << std::setw(8) << record.data;
+  return out.str();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file trace.h
+ * A compact binary trace of execution. Every instruction a program executes is appended as a fixed size record,
+ * either to a ring buffer in memory which keeps the most recent ones, or to a file which is mapped into memory a
+ * chunk at a time so that appending never formats or copies anything. Traces are read back with irisc-trace.
+ */
+
+#ifndef IRISC_TRACE_H
+#define IRISC_TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace vm {
+
+  struct Record {
+    enum FLAGS : uint8_t {
+      EXECUTED = 1 << 0,                            // the condition passed
+      MEMORY = 1 << 1                               // the instruction accessed memory at address
+    };
+    static constexpr uint8_t NONE = 0xff;           // reg when no register other than the PC was written
+
+    uint32_t pc;
+    uint32_t word;                                  // the machine code of the instruction
+    uint32_t value;                                 // the value written to reg
+    uint32_t address;                               // the memory address accessed, if the MEMORY flag is set
+    uint32_t data;                                  // the value loaded or stored
+    uint8_t reg = NONE;                             // the lowest register written, other than the PC
+    uint8_t flags;                                  // FLAGS in the low bits, NZCV after the instruction in the top four
+    uint16_t reserved = 0;
+  };
+
+  // The first record sized slot of a trace file, identifying it
+  struct Header {
+    char magic[8] = {'i', 'R', 'I', 'S', 'C', 'T', 'R', 'C'};
+    uint32_t version = 1;
+    uint32_t recordSize = sizeof(Record);
+    uint64_t reserved = 0;
+  };
+
+  static_assert(sizeof(Record) == 24 && std::is_trivially_copyable_v<Record>);
+  static_assert(sizeof(Header) == sizeof(Record));
+
+  class Trace {
+    private:
+      static constexpr size_t chunk = size_t(1) << 20;            // records mapped from a file at a time
+
+      std::vector<Record> ring;                       // the ring buffer, empty when tracing to a file
+      int file = -1;
+      Record* window = nullptr;                       // the records being appended to
+      Record* cursor = nullptr;
+      Record* end = nullptr;
+      uint64_t chunks = 0;                            // file chunks mapped so far
+      uint64_t written = 0;
+
+      void advance();
+
+    public:
+      Trace(size_t capacity);
+      Trace(const std::string& path);
+      Trace(const Trace&) = delete;
+      ~Trace();
+
+      /**
+       * Appends a record. Only when the current window is full is there anything more to do than a copy.
+       */
+      void append(const Record& record) {
+        if (cursor == end) advance();
+        *cursor++ = record;
+        written++;
+      };
+
+      uint64_t size() const { return written; };
+      bool toFile() const { return file != -1; };
+      std::vector<Record> recent(size_t) const;
+
+      static void save(const std::string& path, const std::vector<Record>&);
+      static std::string format(const Record&, uint64_t step);
+  };
+}
+
+#endif //IRISC_TRACE_H
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <iostream>
 #include <bitset>
+#include <algorithm>
 
 using namespace vm;
 
@@ -11,12 +12,27 @@ static void hover_cb(Fl_Widget* widget, void* window) {
   widgets::HoverBox* hover = (widgets::HoverBox*)widget;
   Instruction* instruction = (Instruction*)window;
   if (hover->hovering())
-    instruction->describe(hover->title(), hover->detail());
+    instruction->explain(hover);
   else
     instruction->describe("Assembled Instruction", "This is the assembled machine code for last instruction, hover over the different sections to see what they mean.");
 }
 
-Instruction::Instruction() {
+Instruction::Instruction() : window(nullptr) {}
+
+/**
+ * Shows or hides the window, building it the first time it is shown.
+ */
+void Instruction::toggle() {
+  Fl::lock();
+    if (!window) build();
+    else if (window->visible()) window->hide();
+    else window->show();
+  Fl::unlock();
+
+  Fl::awake();
+}
+
+void Instruction::build() {
   Fl::lock();
     window = new Fl_Window(500, 160, "Machine Code");
 
@@ -43,6 +59,12 @@ Instruction::Instruction() {
       bits[i] = bit;
     }
 
+    for (int i = 0; i < regions.size(); i++) {
+      regions[i] = new widgets::HoverBox(10, 41, 15, 26, "", "");
+      regions[i]->callback(hover_cb, this);
+      regions[i]->hide();
+    }
+
     Fl_Box* explanation = new Fl_Box(10, 72, 480, 78);
     explanation->box(FL_UP_BOX);
     _title = new Fl_Box(10, 72, 480, 26);
@@ -60,47 +82,94 @@ Instruction::Instruction() {
     window->show();
   Fl::unlock();
 
+  built = true;
   Fl::awake();
 }
 
+/**
+ * Records the instruction which has just been executed. Only the latest one is kept, and it is drawn on the
+ * next refresh, so a program running quickly is not held up by the window. The copy reuses the storage of
+ * the previous one, and the machine code is assembled once per instruction rather than once per execution.
+ */
 void Instruction::set(syntax::InstructionNode* instruction, bool executed) {
-  auto [assembled, explanation] = instruction->assemble();
-  std::bitset<32> machinecode(assembled);
+  instruction->encoding();
+  size_t kind = syntax::kind(*instruction);
+
+  std::lock_guard lock(mutex);
+  syntax::assign(pending[kind], *instruction);
+  this->kind = kind;
+  this->executed = executed;
+  dirty = true;
+}
 
-  Fl::lock();
-    line->copy_label(instruction->toString().c_str());
-    if (executed) { 
-      status->label("Executed"); 
-      status->labelcolor(FL_DARK_GREEN); }
-    else { 
-      status->label("Not Executed"); 
-      status->labelcolor(FL_DARK_RED); 
-    }
+/**
+ * Draws the most recently set instruction if it has not been drawn yet, relabelling only the bits which have
+ * changed and moving the pooled field regions rather than recreating them. Called on the FLTK thread.
+ */
+void Instruction::refresh() {
+  if (!window || !window->visible()) return;
+
+  bool executed;
+  {
+    std::lock_guard lock(mutex);
+    if (!dirty) return;
+    std::swap(pending, shown);
+    current = static_cast<syntax::InstructionNode*>(syntax::node(shown[kind]));
+    executed = this->executed;
+    dirty = false;
+  }
+
+  syntax::InstructionNode* instruction = current;
+  const syntax::Encoding& encoding = instruction->encoding();
+
+  line->copy_label(instruction->toString().c_str());
+  if (executed) { 
+    status->label("Executed"); 
+    status->labelcolor(FL_DARK_GREEN); }
+  else { 
+    status->label("Not Executed"); 
+    status->labelcolor(FL_DARK_RED); 
+  }
+  line->redraw();
+  status->redraw();
+
+  for (int i = 0; i < bits.size(); i++) {
+    bool bit = (encoding.word >> (31 - i)) & 1;
+    if (bit == bool((drawn.word >> (31 - i)) & 1) && drawn.count) continue;
+
+    bits[i]->label(bit ? "1" : "0");
+    bits[i]->redraw();
+  }
+
+  if (encoding.count != drawn.count || encoding.fields != drawn.fields) {
+    int offset = 0;
+    for (int i = 0; i < regions.size(); i++) {
+      if (i >= encoding.count) { regions[i]->hide(); continue; }
 
-    for (widgets::HoverBox* region : regions) {
-      window->remove(region);
-      delete region;
+      int width = syntax::fieldInfo[encoding.fields[i]].width;
+      regions[i]->resize(10+(15*offset), 41, 15*width, 26);
+      regions[i]->show();
+      offset += width;
     }
-    regions.clear();
+    window->redraw();
+  }
+  drawn = encoding;
 
-    for (int i = 0; i < bits.size(); i++) bits[i]->copy_label(std::to_string(machinecode[31 - i]).c_str()); 
+  describe("Assembled Instruction", "This is the assembled machine code for last instruction, hover over the different sections to see what they mean.");
+}
 
-    window->begin();
-    int offset = 0;
-    for (auto [title, detail, range] : explanation) {
-      widgets::HoverBox* region = new widgets::HoverBox(10+(15*offset), 41, 15*range, 26, title, detail);
-      // region->box(FL_UP_FRAME);
-      // region->color(FL_BLACK);
-      region->callback(hover_cb, this);
-      regions.push_back(region);
-      offset += range;
-    }
+/**
+ * Describes the field under a hovered region. The descriptions are only put together now, since most 
+ * instructions are never looked at this closely.
+ */
+void Instruction::explain(widgets::HoverBox* region) {
+  if (!current) return;
 
-    describe("Assembled Instruction", "This is the assembled machine code for last instruction, hover over the different sections to see what they mean.");
-    window->end();
-  Fl::unlock();
+  int index = std::find(regions.begin(), regions.end(), region) - regions.begin();
+  if (index >= drawn.count) return;
 
-  Fl::awake();
+  syntax::FIELD field = drawn.fields[index];
+  describe(syntax::fieldInfo[field].title, current->explain(field));
 }
 
 void Instruction::describe(std::string title, std::string details) {
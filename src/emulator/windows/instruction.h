@@ -8,6 +8,8 @@
 #ifndef IRISC_INSTRUCTION_H
 #define IRISC_INSTRUCTION_H
 
+#include <atomic>
+#include <mutex>
 #include "../../parser/syntax.h"
 #include "../../widgets/hoverbox.h"
 #include <FL/Fl_Window.H>
@@ -20,15 +22,35 @@ namespace vm {
       Fl_Box* line;
       Fl_Box* status;
       std::array<Fl_Box*, 32> bits;
-      std::vector<widgets::HoverBox*> regions;
+      std::array<widgets::HoverBox*, 32> regions;     // one per field of the instruction, hidden when unused
       Fl_Box* _title;
       Fl_Box* _details;
 
+      // the latest instruction set by the emulator thread, waiting for the next refresh to draw it. There is a slot 
+      // for each kind of statement so that copying in an instruction of a different kind doesn't need new storage
+      using Slots = std::array<syntax::Statement, std::variant_size_v<syntax::Statement>>;
+      std::mutex mutex;
+      Slots pending;
+      size_t kind = 0;
+      bool executed;
+      bool dirty = false;
+
+      Slots shown;                                    // the instruction currently drawn, only touched by the FLTK thread
+      syntax::InstructionNode* current = nullptr;
+      syntax::Encoding drawn;
+      std::atomic<bool> built = false;                // whether the window has been built, read by the emulator thread
+
+      void build();
+
     public:
       Instruction();
       Fl_Window* window;
+      void toggle();
+      bool exists() const { return built; };
       void draw();
       void set(syntax::InstructionNode*, bool);
+      void refresh();
+      void explain(widgets::HoverBox*);
       void describe(std::string, std::string);
   };
 
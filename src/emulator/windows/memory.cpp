@@ -1,11 +1,27 @@
 #include "memory.h"
+#include <algorithm>
 #include <iostream>
 #include <FL/Fl.H>
 #include <FL/Fl_Box.H>
 
 using namespace vm;
 
-Memory::Memory() : stack(), data(), _text(), _memstart(0) {
+Memory::Memory() : stack(), _image(std::make_shared<Image>()), data(), _memstart(0), window(nullptr) {}
+
+/**
+ * Shows or hides the window, building it the first time it is shown.
+ */
+void Memory::toggle() {
+  Fl::lock();
+    if (!window) build();
+    else if (window->visible()) window->hide();
+    else window->show();
+  Fl::unlock();
+
+  Fl::awake();
+}
+
+void Memory::build() {
   window = new Fl_Window(340,180,"Memory");
   Fl_Box *box = new Fl_Box(20,40,300,100,"Memory!");
 
@@ -17,28 +33,66 @@ Memory::Memory() : stack(), data(), _text(), _memstart(0) {
   window->set_non_modal();
   window->end();
   window->show();
+};
 
-  std::cout << "stack wake main thread" << std::endl;
+/**
+ * Replaces the current program with one which has already been assembled.
+ */
+void Memory::load(std::shared_ptr<Image> image) {
+  _image = image;
+}
 
-  Fl::awake();
-};
+/**
+ * Appends a single instruction to the end of the text section, taking ownership of it.
+ */
+void Memory::emit(syntax::InstructionNode* instruction) {
+  _image->text.push_back(instruction);
+}
+
+/**
+ * Predecodes and encodes the text section once it has been linked, telling each branch where it is so that its
+ * offset can be encoded. Images reused from the cache are already decoded.
+ */
+void Memory::predecode() {
+  if (_image->decoded.size() == _image->text.size()) return;
+
+  _image->decoded.clear();
+  _image->decoded.reserve(_image->text.size());
+  _image->words.clear();
+  _image->words.reserve(_image->text.size());
+  for (size_t i = 0; i < _image->text.size(); i++) {
+    syntax::InstructionNode* instruction = _image->text[i];
+    if (syntax::BranchNode* branch = dynamic_cast<syntax::BranchNode*>(instruction)) branch->place(_memstart + i * 32);
+
+    _image->decoded.push_back(vm::predecode(*instruction));
+    _image->words.push_back(instruction->encode().word);
+  }
+}
 
 /**
- * Safely disposes of any current instructions and replaces with a new program.
- */ 
-void Memory::setText(std::vector<syntax::InstructionNode*> text) {
-  for (syntax::InstructionNode* instruction : this->_text) free(instruction);
-  this->_text.clear();
-  this->_text = text;
+ * The closest label at or above each instruction, or the empty symbol for those above every label.
+ */
+std::vector<lexer::Symbol> Image::owners() const {
+  std::vector<std::pair<unsigned int, lexer::Symbol>> positions;
+  for (auto const& [label, index] : labels) positions.emplace_back(index, label);
+  std::sort(positions.begin(), positions.end());
+
+  std::vector<lexer::Symbol> owners(text.size());
+  auto label = positions.begin();
+  for (size_t i = 0; i < text.size(); i++) {
+    if (i > 0) owners[i] = owners[i - 1];
+    while (label != positions.end() && label->first <= i) owners[i] = (label++)->second;
+  }
+  return owners;
 }
 
-void Memory::addLabel(std::string label, unsigned int index) {
-  labels.insert({label, index});
+void Memory::addLabel(lexer::Symbol label, unsigned int index) {
+  _image->labels.insert({label, index});
 }
 
-unsigned int Memory::label(std::string label) const {
+unsigned int Memory::label(lexer::Symbol label) const {
   // for (auto [key, value] : labels) std::cout << "[" << key << ", " << value << "]";
-  int index = _memstart + (labels.at(label) * 32); 
+  int index = _memstart + (_image->labels.at(label) * 32); 
   // std::cout << index << std::endl; 
   return index;
 }
@@ -56,7 +110,6 @@ void Memory::allocate(syntax::AllocationNode* node) {
  * to be assembled.
  */
 void Memory::softReset() {
-  labels.clear();
-  _text.clear();
+  _image = std::make_shared<Image>();                   // the previous image is freed once nothing else shares it
   // stack.clear();
 }
\ No newline at end of file
@@ -13,33 +13,64 @@
 #include <bitset>
 #include <vector>
 #include <map>
+#include <memory>
+#include <optional>
 #include <FL/Fl_Window.H>
 #include "../../parser/syntax.h"
+#include "../handlers.h"
 
 // THE STACK IS 8 BYTE ALIGNED - REMEMBER
 namespace vm {
+  /**
+   * An assembled program: the text section, its labels and the entry point. Images are shared so that an
+   * unchanged program can be reloaded from the cache without being assembled again.
+   */
+  struct Image {
+    std::vector<syntax::InstructionNode*> text;
+    std::vector<Decoded> decoded;                     // the text predecoded for execution, filled in before the first run
+    std::vector<uint32_t> words;                      // the machine code of the text, filled in along with decoded
+    std::map<lexer::Symbol, unsigned int> labels;
+    std::optional<uint32_t> entry;
+
+    Image() = default;
+    Image(const Image&) = delete;
+    ~Image() { for (syntax::InstructionNode* instruction : text) delete instruction; };
+    std::vector<lexer::Symbol> owners() const;
+  };
+
   class Memory {
     private:
       std::vector<uint32_t> stack;
-      std::vector<syntax::InstructionNode*> _text;
+      std::shared_ptr<Image> _image;
       std::vector<uint32_t> data;
       std::map<std::string, unsigned int> symbols;
-      std::map<std::string, unsigned int> labels;
       size_t maximum_size;
       size_t current_size;
       size_t _memstart;
 
       Fl_Window* window;
+      void build();
 
     public:
       Memory();
-      std::vector<syntax::InstructionNode*> text() const { return _text; };
+      void toggle();
+      const std::vector<syntax::InstructionNode*>& text() const { return _image->text; };
+      const std::map<lexer::Symbol, unsigned int>& labels() const { return _image->labels; };
+      std::shared_ptr<Image> image() const { return _image; };
       size_t memstart() const { return _memstart; };
-      syntax::InstructionNode* instruction(uint32_t offset) { return _text[(offset - _memstart) / 32]; };
+      size_t size() const { return _image->text.size(); };
+      syntax::InstructionNode* instruction(uint32_t offset) { return _image->text[(offset - _memstart) / 32]; };
+      const Decoded& decoded(uint32_t offset) const { return _image->decoded[(offset - _memstart) / 32]; };
+      uint32_t word(uint32_t offset) const { return _image->words[(offset - _memstart) / 32]; };
+      void predecode();
       void allocate(syntax::AllocationNode*);
-      void addLabel(std::string, unsigned int);
-      unsigned int label(std::string label)const;
-      void setText(std::vector<syntax::InstructionNode*>);
+      void addLabel(lexer::Symbol, unsigned int);
+      bool hasLabel(lexer::Symbol label) const { return _image->labels.contains(label); };
+      unsigned int label(lexer::Symbol label) const;
+      std::optional<uint32_t> entry() const { return _image->entry; };
+      void entry(uint32_t address) { _image->entry = address; };
+      void emit(syntax::InstructionNode*);
+      void load(std::shared_ptr<Image>);
       void push();
       void pop();
       void softReset();
@@ -17,13 +17,29 @@ static void hover_cb(Fl_Widget* widget, void* window) {
     registers->describe("Registers", "A simplified view of the data currently stored in the CPU. Hover over the different sections to learn what they are.");
 }
 
-Registers::Registers() : registers {}, labels {}, cpsr {}, flags {} {
+Registers::Registers() : window(nullptr), registers {}, labels {}, cpsr {}, changed(0), flagged(false), flags {} {
   for (int i = 0; i < registers.size(); i++) registers[i] = proxy(this, i);
+}
 
+/**
+ * Shows or hides the window, building it the first time it is shown. The register values live outside the
+ * window so that sessions which never open it don't pay for its widgets.
+ */
+void Registers::toggle() {
+  Fl::lock();
+    if (!window) build();
+    else if (window->visible()) window->hide();
+    else window->show();
+  Fl::unlock();
+
+  Fl::awake();
+}
+
+void Registers::build() {
   Fl::lock();
     window = new Fl_Window(240,540,"Registers");
     for(auto const& [name, index] : syntax::regMap){
-      Fl_Box* reg = new Fl_Box(10, 10+(25*index), 30, 25, name.c_str());
+      Fl_Box* reg = new Fl_Box(10, 10+(25*index), 30, 25, name.data());
       reg->box(FL_UP_BOX);
       reg->labelfont(FL_BOLD);
       reg->labelsize(13);
@@ -39,7 +55,7 @@ Registers::Registers() : registers {}, labels {}, cpsr {}, flags {} {
 
       // explain on hover
       syntax::REGISTER r = static_cast<syntax::REGISTER>(index);
-      widgets::HoverBox* hover = new widgets::HoverBox(10, 10+(25*index), 220, 25, syntax::regTitle[r], syntax::regExplain[r] + "\nDecimal value: 0\nHex value: 0x0");
+      widgets::HoverBox* hover = new widgets::HoverBox(10, 10+(25*index), 220, 25, syntax::regTitle[r], std::string(syntax::regExplain[r]) + "\nDecimal value: 0\nHex value: 0x0");
       hover->callback(hover_cb, this);
     }
 
@@ -53,7 +69,7 @@ Registers::Registers() : registers {}, labels {}, cpsr {}, flags {} {
 
     for (int i = 0; i < 4; i++) {
       FLAG f = static_cast<FLAG>(i);
-      Fl_Box* flagname = new Fl_Box(110 + (i * 30), 415, 30, 25, flagShortName[f].c_str());
+      Fl_Box* flagname = new Fl_Box(110 + (i * 30), 415, 30, 25, flagShortName[f]);
       flagname->align(FL_ALIGN_LEFT_BOTTOM | FL_ALIGN_INSIDE);
       flagname->labelfont(FL_BOLD);
       flagname->labelsize(9);
@@ -88,38 +104,60 @@ Registers::Registers() : registers {}, labels {}, cpsr {}, flags {} {
   Fl::awake();
 };
 
+/**
+ * Records that a register was written by the current instruction. The window catches up on the next refresh.
+ */
 void Registers::updateReg(int index, uint32_t value) {
-  Fl::lock();
-    labels[index]->copy_label(regstr(value).c_str());
-    labels[index]->color(FL_YELLOW);
-    labels[index]->redraw();
-  Fl::unlock();
-
-  Fl::awake();
+  changed |= 1 << index;
 }
 
 void Registers::prepare() {
-  Fl::lock();
-    for (int i = 0; i < registers.size(); i++) {
-      labels[i]->color(FL_BACKGROUND_COLOR);
-      labels[i]->redraw();
-    }
-  Fl::unlock();
-
-  Fl::awake();
+  changed = 0;
+  flagged = false;
 }
 
 void Registers::clear() {
-  Fl::lock();
-    for (int i = 0; i < registers.size(); i++) {
-      registers[i] = proxy(this, i);
-      labels[i]->color(FL_BACKGROUND_COLOR);
-      labels[i]->copy_label(regstr(0).c_str());
-      labels[i]->redraw();
-    }
-  Fl::unlock();
+  changed = 0;
+  flagged = false;
+  for (int i = 0; i < registers.size(); i++) registers[i] = proxy(this, i);
+}
 
-  Fl::awake();
+/**
+ * Brings the window up to date with a published state, redrawing only the boxes whose contents have changed
+ * since the last refresh. Called on the FLTK thread.
+ */
+void Registers::show(const State& state) {
+  if (!window || !window->visible()) return;
+
+  for (int i = 0; i < registers.size(); i++) {
+    Fl_Color color = state.changed & (1 << i) ? FL_YELLOW : FL_BACKGROUND_COLOR;
+    if (state.registers[i] == shown.registers[i] && labels[i]->color() == color) continue;
+
+    labels[i]->copy_label(regstr(state.registers[i]).c_str());
+    labels[i]->color(color);
+    labels[i]->redraw();
+  }
+
+  for (int flag : {N, Z, C, V}) {
+    bool set = state.cpsr & (1u << (31 - flag));
+    if (set == bool(shown.cpsr & (1u << (31 - flag)))) continue;
+
+    flags[flag]->label(set ? "1" : "0");
+    flags[flag]->redraw();
+  }
+
+  shown = state;
+}
+
+/**
+ * Copies the register values and flags into a state record for publishing.
+ */
+void Registers::capture(State& state) const {
+  for (int i = 0; i < registers.size(); i++) state.registers[i] = registers[i].value;
+  state.cpsr = 0;
+  for (int flag : {N, Z, C, V}) state.cpsr |= uint32_t(cpsr[flag]) << (31 - flag);
+  state.changed = changed;
+  state.flagged = flagged;
 }
 
 std::string Registers::regstr(u_int32_t value) {
@@ -131,41 +169,15 @@ std::string Registers::regstr(u_int32_t value) {
   return ss.str();
 }
 
-/** TODO: check the logic for setting the carry bit
- * Sets the CPSR flags based on the result of the executing instruction
+/**
+ * Sets the CPSR flags. Instructions work out the carry and overflow themselves since they depend on the operation.
  */
-void Registers::setFlags(uint32_t op1, uint32_t op2, uint64_t result, char _operator) {
-  int sign1 = std::bitset<32>(op1)[31];               // sign of left hand operand
-  int sign2 = std::bitset<32>(op2)[31];               // sign of right hand operand
-  int signr = std::bitset<32>(result)[31];            // sign of result
-  std::bitset<33> result_ext(result);                 // msb = carry bit
-
-  // std::cout << std::bitset<33>(result) << std::endl;
-
-  // std::cout << "\n" << "sign1: " << sign1 << ", sign2: " << sign2 << ", signr: " << signr << ", operator: " << _operator << std::endl;
-  // std::cout << result_ext[32] << " " << std::bitset<32>(result) << std::endl;
-
-  cpsr[N] = result_ext[31] == 1;                      // msb = 1
-  cpsr[Z] = (uint32_t)result == 0;                    // all bits = 0
-  cpsr[C] = result_ext[32];                           // unsigned overflow
-
-  if (_operator == '+') cpsr[V] = sign1 == sign2 && sign1 != signr;         // two operands of the same sign result in changed sign
-  else if (_operator == '-') cpsr[V] = sign1 != sign2 && sign2 == signr;    // signs different and result sign same as subtrahend
-  
-  // std::cout << "  negative flag: " << cpsr[N] << "\n"
-  //           << "  zero flag: " << cpsr[Z] << "\n"
-  //           << "  carry flag: " << cpsr[C] << "\n"
-  //           << "  overflow flag: " << cpsr[V] << std::endl;
-
-  Fl::lock();
-    for (int flag : {N, Z, C, V}) {
-      // std::cout << std::to_string(cpsr[flag]).c_str() << std::endl;
-      flags[flag]->copy_label(std::to_string(cpsr[flag]).c_str());
-      flags[flag]->redraw();
-    }
-  Fl::unlock();
-
-  Fl::awake();                                     
+void Registers::setFlags(bool negative, bool zero, bool carry, bool overflow) {
+  cpsr[N] = negative;
+  cpsr[Z] = zero;
+  cpsr[C] = carry;
+  cpsr[V] = overflow;
+  flagged = true;
 }
 
 /** TODO: check that each of these works as expected
@@ -17,6 +17,8 @@
 #include <FL/Fl_Box.H>
 #include "../../parser/syntax.h"
 #include "../../widgets/hoverbox.h"
+#include "../snapshot.h"
+#include "../constants.h"
 
 namespace vm {
 
@@ -53,23 +55,33 @@ namespace vm {
       Fl_Window* window;
       std::array<proxy, 16> registers;
       bool cpsr[4];
+      uint16_t changed;                               // registers written since the last prepare
+      bool flagged;                                   // whether the flags were written since the last prepare
+      State shown;                                    // what the window currently displays
       std::array<Fl_Box*, 16> labels;
       std::array<Fl_Box*, 4> flags;
       std::string regstr(uint32_t);
       Fl_Box* _title;
       Fl_Box* _details;
+      void build();
 
     public:
       Registers();
+      void toggle();
       void draw();
       void update();
+      void show(const State&);
       void updateReg(int, uint32_t);
       void prepare();
       void clear();
-      void setFlags(uint32_t, uint32_t, uint64_t, char _operator = ' ');
+      void setFlags(bool, bool, bool, bool);
+      bool flag(FLAG flag) const { return cpsr[flag]; };
       bool checkFlags(syntax::CONDITION);
       void describe(std::string, std::string);
+      void capture(State&) const;
       proxy& operator[] (int index) { return registers[index]; };
+      uint32_t value(int index) const { return registers[index].value; };
+      uint16_t written() const { return changed; };
   };
 
 }
@@ -21,6 +21,8 @@ class Error : public std::exception {
     Error(std::string msg, std::vector<lexer::Token> statement, int tokenIndex);
     virtual const char* what() const noexcept override = 0;
     std::string constructHelper() const;
+    std::string location() const;
+    std::string message() const { return msg; };
 };
 
 inline Error::Error(std::string msg, std::vector<lexer::Token> statement, int tokenIndex) : 
@@ -30,6 +32,15 @@ inline Error::Error(std::string msg, std::vector<lexer::Token> statement, int to
   tokenIndex(tokenIndex)
 {}
 
+/**
+ * Describes the source line of the offending statement. Interactive statements are lexed from line 0 and
+ * so have no location.
+ */
+inline std::string Error::location() const {
+  if (statement.empty() || statement[0].lineNumber() == 0) return "";
+  return " (line " + std::to_string(statement[0].lineNumber()) + ")";
+}
+
 inline std::string Error::constructHelper() const {
   std::string helper = "";
   for (int i = 0; i < statement.size(); i++) {
@@ -55,20 +66,31 @@ class LexicalError : public std::exception {
     std::string msg;
     std::string statement;
     unsigned int symbolIndex;
+    unsigned int lineNumber;
 
   public:
-    LexicalError(std::string msg, std::string statement, unsigned int symbolIndex);
+    LexicalError(std::string msg, std::string statement, unsigned int symbolIndex, unsigned int lineNumber = 0);
     const char* what() const noexcept override;
     std::string constructHelper() const;
+    std::string location() const;
+    std::string message() const { return msg; };
 };
 
-inline LexicalError::LexicalError(std::string msg, std::string statement, unsigned int symbolIndex) : 
+inline LexicalError::LexicalError(std::string msg, std::string statement, unsigned int symbolIndex, unsigned int lineNumber) : 
   std::exception(),
   msg(msg),
   statement(statement),
-  symbolIndex(symbolIndex)
+  symbolIndex(symbolIndex),
+  lineNumber(lineNumber)
 {}
 
+/**
+ * Describes the source line of the offending text, as Error::location does.
+ */
+inline std::string LexicalError::location() const {
+  return lineNumber ? " (line " + std::to_string(lineNumber) + ")" : "";
+}
+
 inline std::string LexicalError::constructHelper() const {
   std::string helper = "";
   for (int i = 0; i < statement.size(); i++) {
@@ -86,7 +108,7 @@ inline std::string LexicalError::constructHelper() const {
 
 inline const char* LexicalError::what() const noexcept {
   std::stringstream stream;
-  stream << "\033[91mLexical Error\033[0m: " << msg << "\n\t" << constructHelper();
+  stream << "\033[91mLexical Error\033[0m" << location() << ": " << msg << "\n\t" << constructHelper();
 
   std::string* out = new std::string(stream.str());
   return out->c_str();
@@ -105,7 +127,7 @@ class SyntaxError : public Error {
 
 inline const char* SyntaxError::what() const noexcept {
   std::stringstream stream;
-  stream << "\033[91mSyntax Error\033[0m: " << msg << "\n\t" << constructHelper();
+  stream << "\033[91mSyntax Error\033[0m" << location() << ": " << msg << "\n\t" << constructHelper();
 
   std::string* out = new std::string(stream.str());
   return out->c_str();
@@ -124,7 +146,7 @@ class NumericalError : public Error {
 
 inline const char* NumericalError::what() const noexcept {
   std::stringstream stream;
-  stream << "\033[91mNumerical Error\033[0m: " << msg << "\n\t" << constructHelper();
+  stream << "\033[91mNumerical Error\033[0m" << location() << ": " << msg << "\n\t" << constructHelper();
 
   std::string* out = new std::string(stream.str());
   return out->c_str();
@@ -143,7 +165,7 @@ class AssemblyError : public Error {
 
 inline const char* AssemblyError::what() const noexcept {
   std::stringstream stream;
-  stream << "\033[91mAssembly Error\033[0m: " << msg << "\n\t" << constructHelper();
+  stream << "\033[91mAssembly Error\033[0m" << location() << ": " << msg << "\n\t" << constructHelper();
 
   std::string* out = new std::string(stream.str());
   return out->c_str();
@@ -162,7 +184,7 @@ class RuntimeError : public Error {
 
 inline const char* RuntimeError::what() const noexcept {
   std::stringstream stream;
-  stream << "\033[91mRuntime Error\033[0m: " << msg << "\n\t" << constructHelper();
+  stream << "\033[91mRuntime Error\033[0m" << location() << ": " << msg << "\n\t" << constructHelper();
 
   std::string* out = new std::string(stream.str());
   return out->c_str();
@@ -181,7 +203,7 @@ class InteractiveError : public Error {
 
 inline const char* InteractiveError::what() const noexcept {
   std::stringstream stream;
-  stream << "\033[91mInteractive Error\033[0m: " << msg << "\n\t" << constructHelper();
+  stream << "\033[91mInteractive Error\033[0m" << location() << ": " << msg << "\n\t" << constructHelper();
 
   std::string* out = new std::string(stream.str());
   return out->c_str();
@@ -1,6 +1,5 @@
 #include "lexer.h"
 #include "../error.h"
-#include <stack>
 #include <string>
 #include <stdexcept>
 #include <iostream>
@@ -8,49 +7,65 @@
 
 using namespace lexer;
 
-Lexer::Lexer(std::string& program) {
-  unsigned int current_index = 0;
-  unsigned int tokenIndex = 0;
-  unsigned int lineIndex = 1;
+Lexer::Lexer(std::string_view program, unsigned int lineNumber) : program(program), lineIndex(lineNumber) {}
 
-  // Tokenise the program, ignoring comments
-  Token t;
-  while(current_index <= program.length() && program.substr(current_index, program.size()).find_first_not_of('\0') != std::string::npos) {
-    if (hasToken(program, current_index)) {
-      t = nextToken(program, current_index, tokenIndex, lineIndex);
+Lexer::~Lexer() = default;
 
-      if (t.type() == END) lineIndex++;
-      tokens.push_back(t);
-    }
-  }
+/**
+ * Points the lexer at a new program so that one lexer, and its scratch space, can be reused for many statements.
+ */
+void Lexer::reset(std::string_view program, unsigned int lineNumber) {
+  this->program = program;
+  current_index = 0;
+  tokenIndex = 0;
+  lineIndex = lineNumber;
+  lookahead.reset();
 }
 
-Lexer::~Lexer() = default;
-
+/**
+ * Tokens are produced lazily so that only the statement currently being parsed is held in memory.
+ */
 Token Lexer::peekToken() {
-  if(current_token < tokens.size())
-    return tokens[current_token];
-  else {
-      std::string error = "Final token surpassed.";
-      return Token(ERROR, error);
-  }
+  if (!lookahead) lookahead = scanToken();
+
+  if (lookahead) return *lookahead;
+  else return Token(ERROR, "End of input.");
 }
 
 Token Lexer::nextToken() {
-  if(current_token < tokens.size())
-      return tokens[current_token++];
-  else {
-      std::cout << "nextToken" << std::endl;
-      std::string error = "Final token surpassed.";
-      return Token(ERROR, error);
-  }
+  Token token = peekToken();
+  if (lookahead) lookahead.reset();
+  else std::cout << "nextToken" << std::endl;
+
+  return token;
 }
 
+/**
+ * Lexes every remaining token in the program. This defeats the lazy lexing so should only be used for debugging.
+ */
 std::vector<Token> Lexer::getTokens() {
+  std::vector<Token> tokens;
+  while (peekToken().type() != ERROR) tokens.push_back(nextToken());
   return tokens;
 }
 
-bool Lexer::hasToken(std::string &program, unsigned int &current_index) {
+/**
+ * Lexes the next token in the program, ignoring whitespace and trailing null characters.
+ */
+std::optional<Token> Lexer::scanToken() {
+  while(current_index <= program.length() && program.find_first_not_of('\0', current_index) != std::string_view::npos) {
+    if (hasToken()) {
+      Token t = lexToken();
+
+      if (t.type() == END) lineIndex++;
+      return t;
+    }
+  }
+
+  return std::nullopt;
+}
+
+bool Lexer::hasToken() {
   while(current_index < program.length() && (program[current_index] == ' ' || program[current_index] == '\t'))
     current_index++;
 
@@ -58,16 +73,16 @@ bool Lexer::hasToken(std::string &program, unsigned int &current_index) {
   return true;
 }
 
-Token Lexer::nextToken(std::string &program, unsigned int &current_index, unsigned int &tokenIndex, unsigned int &lineIndex) {
+Token Lexer::lexToken() {
 
     // Setup stack and lexeme
     int current_state = 0;
-    std::stack<int> state_stack;
     char current_symbol;
-    std::string lexeme;
+    states.clear();
+    lexeme.clear();
 
     // Push 'BAD' state on the stack
-    state_stack.push(-1);
+    states.push_back(-1);
 
     // // Ignore whitespaces or newlines in front of lexeme
     // while(current_index < program.length() &&
@@ -76,16 +91,15 @@ Token Lexer::nextToken(std::string &program, unsigned int &current_index, unsign
     
     // While current state is not error state
     while(current_state != e){
-      current_symbol = program[current_index];
+      current_symbol = current_index < program.length() ? program[current_index] : '\0';    // the view may not be null terminated
       lexeme += current_symbol;
 
       // If current state is final, remove previously recorded final states
       if (f_states[current_state])
-          while(!state_stack.empty())
-              state_stack.pop();
+          states.clear();
 
       // and push current one on the stack
-      state_stack.push(current_state);
+      states.push_back(current_state);
 
       // Go to next state using delta function in DFA
       current_state = nextState(current_state, current_symbol);
@@ -101,29 +115,29 @@ Token Lexer::nextToken(std::string &program, unsigned int &current_index, unsign
     // Rollback loop
     int errorIndex = current_index - 2;
 
-    while(!f_states[current_state] && current_state != -1){
-      current_state = state_stack.top();
-      state_stack.pop();
+    while(current_state != -1 && !f_states[current_state]){
+      current_state = states.back();
+      states.pop_back();
       lexeme.pop_back();
       current_index--;
     }
 
-    if(current_state == -1 && tokens.size() > 1) {
-      std::string::reverse_iterator rLineStart = std::find_if(program.rbegin() + program.size() - errorIndex, program.rend(), [](char c){ return c == '\n' || c == std::string::npos; });
-      std::string::iterator lineStart = rLineStart.base();
+    if(current_state == -1 && tokenIndex > 1) {
+      std::string_view::const_reverse_iterator rLineStart = std::find_if(program.rbegin() + program.size() - errorIndex, program.rend(), [](char c){ return c == '\n' || c == std::string::npos; });
+      std::string_view::const_iterator lineStart = rLineStart.base();
       std::string statement(lineStart, std::find_if(lineStart, program.end(), [](char c){ return c == '\n' || c == std::string::npos; }));
 
       int startIndex = lineStart - program.begin();
       errorIndex = errorIndex - startIndex;
 
-      throw LexicalError("Invalid token starting at position " + std::to_string(errorIndex + 1) + ".", statement, errorIndex + 1);
+      throw LexicalError("Invalid token starting at position " + std::to_string(errorIndex + 1) + ".", statement, errorIndex + 1, lineIndex);
     }
 
     if(current_state >= 0 && f_states[current_state]) {
-      return Token(current_state, std::move(lexeme), lineIndex, tokenIndex++);
+      return Token(current_state, lexeme, lineIndex, tokenIndex++);
     }
     else {
-      throw LexicalError("Starting character is not recognised.", program, errorIndex);
+      throw LexicalError("Starting character is not recognised.", std::string(program), errorIndex, lineIndex);
     }
 }
 
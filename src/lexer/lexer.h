@@ -9,6 +9,8 @@
 #define IRISC_LEXER_H
 
 #include <string>
+#include <string_view>
+#include <optional>
 #include <vector>
 #include "token.h"
 
@@ -37,11 +39,11 @@ namespace lexer {
   
   class Lexer {
     private:
-      const unsigned int e = 11;
-      const unsigned int f_states[12] =  
+      static constexpr unsigned int e = 11;
+      static constexpr unsigned int f_states[12] =  
         /*               S0  S1  S2  S3  S4  S5  S6  S7  s8  S9 S10  Se */
                         { 0,  1,  1,  1,  1,  0,  1,  1,  1,  0,  1,  0 };
-      const unsigned int t_table[18][11] = {
+      static constexpr unsigned int t_table[18][11] = {
         /*               S0  S1  S2  S3  S4  S5  S6  S7  S8  S9 S10 */
         /*   '#'   */  {  5,  e,  e,  e,  e,  e,  e,  e,  e,  9,  e  },
         /*   '.'   */  {  2,  e,  e,  e,  e,  e,  e,  e,  e,  9,  e  },
@@ -63,19 +65,27 @@ namespace lexer {
         /*  OTHER  */  {  e,  e,  e,  e,  e,  e,  e,  e,  e,  9,  e  }
       };
 
-      unsigned int current_token = 0;
-      std::vector<Token> tokens;
+      std::string_view program;
+      unsigned int current_index = 0;
+      unsigned int tokenIndex = 0;
+      unsigned int lineIndex;
+      std::optional<Token> lookahead;       // tokens are lexed on demand, one ahead of the parser
+      std::vector<int> states;              // scratch space reused by every token, so lexing does not allocate
+      std::string lexeme;
 
       int nextState(int, char);
-      bool hasToken(std::string&, unsigned int&);
-      Token nextToken(std::string&, unsigned int&, unsigned int&, unsigned int&);
+      bool hasToken();
+      std::optional<Token> scanToken();
+      Token lexToken();
 
     public:
-      Lexer(std::string&);
+      Lexer(std::string_view, unsigned int lineNumber = 1);
+      void reset(std::string_view, unsigned int lineNumber = 1);
       
       Token peekToken();
       Token nextToken();
       std::vector<Token> getTokens();
+      unsigned int position() const { return current_index; };   // one past the most recently lexed token
       ~Lexer();
   };
 }
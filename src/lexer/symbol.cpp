@@ -0,0 +1,80 @@
+/**
+ * @file symbol.cpp
+ */
+
+#include "symbol.h"
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace lexer;
+
+namespace {
+  /**
+   * The pool is shared by the whole process rather than owned by a program, since names outlive the text they
+   * were lexed from in errors, in the editor and in cached images. Only names are interned, so it grows with the
+   * labels a session has seen rather than with everything it has lexed.
+   *
+   * Names are never removed. Their text is kept in a deque, which never moves its elements, and a view of each
+   * is kept in chunks which are never moved or freed either, so reading a name needs no lock: only adding one
+   * does, and the count of names is published once its view is in place.
+   */
+  struct Pool {
+    static constexpr size_t chunk = 4096;                                 // names per chunk of views
+    static constexpr size_t chunks = 1024;
+
+    std::mutex mutex;                                                     // taken by intern only
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, Symbol> ids;
+    std::array<std::atomic<std::string_view*>, chunks> views {};
+    std::atomic<uint32_t> count = 0;
+
+    Pool() { add(""); }
+
+    Symbol add(std::string_view text) {
+      uint32_t id = count.load(std::memory_order_relaxed);
+      if (id == chunk * chunks) throw std::length_error("Too many names to intern.");
+
+      std::string_view* views = this->views[id / chunk].load(std::memory_order_relaxed);
+      if (!views) this->views[id / chunk].store(views = new std::string_view[chunk], std::memory_order_release);
+
+      std::string_view name = names.emplace_back(text);
+      views[id % chunk] = name;
+      ids.emplace(name, Symbol{id});
+      count.store(id + 1, std::memory_order_release);
+      return Symbol{id};
+    }
+  };
+
+  Pool& pool() {
+    static Pool pool;
+    return pool;
+  }
+}
+
+/**
+ * The symbol for some text, adding it to the pool the first time it is seen.
+ */
+Symbol lexer::intern(std::string_view text) {
+  Pool& pool = ::pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+
+  auto found = pool.ids.find(text);
+  if (found != pool.ids.end()) return found->second;
+  return pool.add(text);
+}
+
+/**
+ * The text of a symbol. This never locks, so any number of threads can read names while others intern them.
+ */
+std::string_view lexer::name(Symbol symbol) {
+  Pool& pool = ::pool();
+  uint32_t id = static_cast<uint32_t>(symbol);
+  if (id >= pool.count.load(std::memory_order_acquire)) return {};
+
+  return pool.views[id / Pool::chunk].load(std::memory_order_acquire)[id % Pool::chunk];
+}
@@ -0,0 +1,21 @@
+/**
+ * @file symbol.h
+ * Interned names. Each distinct label or variable name is stored once and afterwards referred to by a small id, so
+ * that tokens can be copied freely and names can be compared without comparing strings.
+ */
+
+#ifndef IRISC_SYMBOL_H
+#define IRISC_SYMBOL_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace lexer {
+
+  enum class Symbol : uint32_t {};        // the empty string is always Symbol{}
+
+  Symbol intern(std::string_view);
+  std::string_view name(Symbol);
+}
+
+#endif //IRISC_SYMBOL_H
@@ -7,25 +7,173 @@
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
 #include "token.h"
 
 using namespace lexer;
 
-Token::Token() = default;
+namespace {
+  /**
+   * Reads the digits of a numeric token, after any '#' and base prefix. Values too large for 64 bits saturate.
+   */
+  uint64_t number(TOKEN type, std::string_view text) {
+    int base;
+    std::string_view digits;
+    if (type == IMM_BIN || type == BIN) { base = 2; digits = "01"; }
+    else if (type == IMM_OCT || type == OCT) { base = 8; digits = "01234567"; }
+    else if (type == IMM_DEC || type == DEC) { base = 10; digits = "0123456789"; }
+    else { base = 16; digits = "0123456789abcdef"; }
 
-Token::Token(int final_state, std::string value, unsigned int lineNumber, unsigned int tokenNumber) :
+    text = text.substr(text.find_last_not_of(digits) + 1);                // npos + 1 is the start of the text
+    uint64_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    if (error == std::errc::result_out_of_range) return UINT64_MAX;
+    return value;
+  }
+
+  constexpr std::string_view letters = "abcdefghijklmnopqrstuvwxyz";    // modifiers are viewed here
+
+  constexpr std::string_view registerNames[16] = {
+    "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", "r12", "sp", "lr", "pc"
+  };
+}
+
+/**
+ * Constructs a token from the lexer's final state and lexeme. The lexeme is lowercased in place, since the 
+ * lexer's buffer is scratch space anyway.
+ */
+Token::Token(int final_state, std::string& value, unsigned int lineNumber, unsigned int tokenNumber) :
   m_type(tokenType(final_state, value)),
-  m_value(value),
-  m_lineNumber(lineNumber),
-  m_tokenNumber(tokenNumber)
-{}
+  m_tokenNumber(tokenNumber),
+  m_lineNumber(lineNumber)
+{
+  decode(value);
+}
 
-Token::Token(TOKEN type, std::string value, unsigned int lineNumber, unsigned int tokenNumber) :
+Token::Token(TOKEN type, std::string_view value, unsigned int lineNumber, unsigned int tokenNumber) :
   m_type(type),
-  m_value(value),
-  m_lineNumber(lineNumber),
-  m_tokenNumber(tokenNumber)
-{}
+  m_tokenNumber(tokenNumber),
+  m_lineNumber(lineNumber)
+{
+  decode(value);
+}
+
+/**
+ * Decodes the token text into the payload, so that neither the parser nor anything holding the token needs the
+ * text again. Text which does not fit its type, as can happen when a token is read back from disk, makes an 
+ * ERROR token instead.
+ */
+void Token::decode(std::string_view text) {
+  m_length = std::min<size_t>(text.size(), UINT8_MAX);
+
+  switch (type()) {
+    case REGISTER:
+      if (text == "sp") m_payload = 13;
+      else if (text == "lr") m_payload = 14;
+      else if (text == "pc") m_payload = 15;
+      else if (text.size() < 2 || std::from_chars(text.data() + 1, text.data() + text.size(), m_payload).ec != std::errc() || m_payload > 12) break;
+      return;
+    case IMM_BIN: case IMM_OCT: case IMM_DEC: case IMM_HEX:
+    case BIN: case OCT: case DEC: case HEX: {
+      uint64_t value = number(type(), text);
+      m_high = value >> 32;
+      m_payload = uint32_t(value);
+      return;
+    }
+    case BRANCH: case BI_OPERAND: case TRI_OPERAND: case LOAD_STORE: case SHIFT: {
+      auto match = operation(text);
+      if (!match) break;
+
+      std::string_view suffix = text.substr(match->first.size());
+      char modifier = 0;
+      if (suffix.size() == 1 || suffix.size() == 3) {
+        if (suffix[0] < 'a' || suffix[0] > 'z') break;
+        modifier = suffix[0];
+        suffix.remove_prefix(1);
+      }
+      auto condition = std::find(std::begin(conditions), std::end(conditions), suffix);
+      if (!suffix.empty() && condition == std::end(conditions)) break;
+
+      auto op = std::find_if(operations.begin(), operations.end(), [&](auto const& op) { return op.first == match->first; });
+      m_payload = uint32_t(op - operations.begin()) | uint32_t(uint8_t(modifier)) << 8;
+      if (!suffix.empty()) m_payload |= uint32_t(condition - std::begin(conditions) + 1) << 16;
+      return;
+    }
+    case COMMA: case OPEN_SQR: case CLOSE_SQR: case EXCLAMATION: case END:
+      m_payload = text.empty() ? 0 : uint8_t(text[0]);
+      return;
+    case LABEL:
+      if (text.empty()) break;
+      m_payload = static_cast<uint32_t>(intern(text.substr(0, text.size() - 1)));        // without the colon
+      return;
+    case VARIABLE:
+      if (text.empty()) break;
+      m_payload = static_cast<uint32_t>(intern(text.substr(1)));                         // without the equals sign
+      return;
+    default:                                                                              // names, and text which can't be rebuilt
+      m_payload = static_cast<uint32_t>(intern(text));
+      return;
+  }
+
+  m_type = ERROR;
+  m_payload = static_cast<uint32_t>(intern(text));
+}
+
+/**
+ * The text of the token, rebuilt from its payload. Registers and immediates come back in their usual spelling,
+ * e.g. without leading zeros, which may differ from how they were typed.
+ */
+std::string Token::value() const {
+  switch (type()) {
+    case REGISTER: return std::string(registerNames[m_payload]);
+    case IMM_BIN: case IMM_OCT: case IMM_DEC: case IMM_HEX:
+    case BIN: case OCT: case DEC: case HEX: {
+      bool imm = type() <= IMM_HEX;
+      int base = 10;
+      std::string text = imm ? "#" : "";
+      switch (imm ? type() : TOKEN(type() - BIN + IMM_BIN)) {
+        case IMM_BIN: base = 2; text += "0b"; break;
+        case IMM_OCT: base = 8; text += immediate() ? "0" : ""; break;
+        case IMM_HEX: base = 16; text += "0x"; break;
+        default: break;
+      }
+
+      char digits[64];
+      auto [end, error] = std::to_chars(std::begin(digits), std::end(digits), immediate(), base);
+      return text.append(digits, end);
+    }
+    case BRANCH: case BI_OPERAND: case TRI_OPERAND: case LOAD_STORE: case SHIFT: {
+      auto [operation, modifier, condition] = mnemonic();
+      return std::string(operation).append(modifier).append(condition);
+    }
+    case COMMA: case OPEN_SQR: case CLOSE_SQR: case EXCLAMATION: case END:
+      return m_length ? std::string(1, char(m_payload)) : "";
+    case LABEL: return std::string(name(symbol())) + ':';
+    case VARIABLE: return '=' + std::string(name(symbol()));
+    default: return std::string(name(symbol()));
+  }
+}
+
+/**
+ * The operation of an operation token, with its modifier and condition if it has them. All three view static
+ * tables, so they outlive the token.
+ */
+std::tuple<std::string_view, std::string_view, std::string_view> Token::mnemonic() const {
+  std::string_view modifier;
+  if (char letter = (m_payload >> 8) & 0xff) modifier = letters.substr(letter - 'a', 1);
+
+  unsigned int condition = m_payload >> 16;
+  return {operations[m_payload & 0xff].first, modifier, condition ? conditions[condition - 1] : std::string_view()};
+}
+
+size_t Token::size() const {
+  switch (type()) {
+    case LABEL: case VARIABLE: return name(symbol()).size() + 1;
+    case DIRECTIVE: case OP_LABEL: case STRING: case ERROR: return name(symbol()).size();
+    default: return m_length;
+  }
+}
 
 TOKEN Token::tokenType(int final_state, std::string &value) {
   // to lower case
@@ -38,26 +186,24 @@ TOKEN Token::tokenType(int final_state, std::string &value) {
 
   switch(final_state) {
     case 1: {
-      TOKEN token;
-      std::map<std::string, TOKEN>::reverse_iterator it = std::find_if(operations.rbegin(), operations.rend(), [value](const std::pair<std::string, TOKEN> op){ return value.substr(0, op.first.size()) == op.first; });
-      if (it != operations.rend()) {
-        std::string operation = it->first;
-        token = it->second;
+      if (auto match = operation(value)) {
+        auto [operation, token] = *match;
+        auto isCondition = [](std::string_view suffix){ return std::find(std::begin(conditions), std::end(conditions), suffix) != std::end(conditions); };
 
-        std::string suffix = value.substr(operation.size(), value.size());
+        std::string_view suffix = std::string_view(value).substr(operation.size());
         if (suffix.size() == 1 || suffix.size() == 3) {                                                       // valid operation suffixes are up to 3 letters long maximum
           char modifier = suffix[0];
-          suffix = suffix.substr(1, suffix.size());
+          suffix = suffix.substr(1);
           
-          if (suffix.size() == 0 || std::any_of(conditions.begin(), conditions.end(), [suffix](const std::string s){ return s == suffix; })) {
-            if ( token == LOAD_STORE && std::any_of(sizes.begin(), sizes.end(), [modifier](const char c){ return c == modifier; }) ||
-                 token == BRANCH && std::any_of(modifiers.begin(), modifiers.end(), [modifier](const char c){ return c == modifier; }) ||
-                (token == BI_OPERAND || token == TRI_OPERAND) && modifier == 's') {
+          if (suffix.size() == 0 || isCondition(suffix)) {
+            if ( token == LOAD_STORE && sizes.find(modifier) != std::string_view::npos ||
+                 token == BRANCH && modifiers.find(modifier) != std::string_view::npos ||
+                (token == BI_OPERAND || token == TRI_OPERAND || token == SHIFT) && modifier == 's') {
               return token;
             }
           }
         }                                                      
-        else if (suffix.size() == 0 || suffix.size() == 2 && std::any_of(conditions.begin(), conditions.end(), [suffix](const std::string s){ return s == suffix; })) {
+        else if (suffix.size() == 0 || suffix.size() == 2 && isCondition(suffix)) {
           return token;
         }      
       }
@@ -8,9 +8,16 @@
 #ifndef IRISC_TOKEN_H
 #define IRISC_TOKEN_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <array>
+#include <optional>
+#include <tuple>
+#include <utility>
 #include <vector>
-#include <map>
+#include "symbol.h"
 
 namespace lexer {
 
@@ -53,80 +60,106 @@ namespace lexer {
   };
 
   // static std::vector<std::string> operations = {"mov", "cmp", "add", "sub", "ldr", "str", "lsl", "lsr", "b"};
-  namespace {
-    std::vector<char> modifiers = {'l'};
-    std::vector<std::string> conditions = {"eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc", "hi", "ls", "ge", "lt", "gt", "le", "al"};
-    std::vector<char> sizes = {'b', 'h'};
-
-    std::map<std::string, TOKEN> operations {
-      // bi-operand instructions
-      {"mov", BI_OPERAND}, {"mvn", BI_OPERAND}, {"tst", BI_OPERAND}, {"teq", BI_OPERAND}, {"cmp", BI_OPERAND}, {"cmn", BI_OPERAND},
-
-      // tri-operand instructions
-      {"and", TRI_OPERAND}, {"eor", TRI_OPERAND}, {"sub", TRI_OPERAND}, {"rsb", TRI_OPERAND}, {"add", TRI_OPERAND}, 
-      {"adc", TRI_OPERAND}, {"sbc", TRI_OPERAND}, {"rsc", TRI_OPERAND}, {"orr", TRI_OPERAND}, {"bic", TRI_OPERAND}, 
-
-      // shift instructions
-      {"lsl", SHIFT}, {"lsr", SHIFT}, {"asr", SHIFT}, {"ror", SHIFT},
-      
-      //load/store instructions
-      {"ldr", LOAD_STORE}, {"str", LOAD_STORE},
-
-      // branch instructions
-      {"bx", BRANCH}, {"bl", BRANCH}, { "b", BRANCH}
-    };
-
-    std::string tokenNames[] = {
-      "LABEL",
-      "DIRECTIVE",
-
-      "BRANCH",
-      "BI_OPERAND",
-      "TRI_OPERAND",
-      "LOAD_STORE",
-      "SHIFT",
-
-      "REGISTER",
-      "IMM_BIN",
-      "IMM_OCT",
-      "IMM_DEC",
-      "IMM_HEX",
-      "VARIABLE",
-      "OP_LABEL",
-
-      "STRING",
-      "BIN",
-      "OCT",
-      "DEC",
-      "HEX",
-
-      "COMMA",
-      "OPEN_SQR",
-      "CLOSE_SQR",
-      "EXCLAMATION",
-      
-      "END",
-      "ERROR"
-    };
+  inline constexpr std::string_view modifiers = "l";
+  inline constexpr std::string_view conditions[] = {"eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc", "hi", "ls", "ge", "lt", "gt", "le", "al"};
+  inline constexpr std::string_view sizes = "bh";
+
+  inline constexpr auto operations = std::to_array<std::pair<std::string_view, TOKEN>>({
+    // bi-operand instructions
+    {"mov", BI_OPERAND}, {"mvn", BI_OPERAND}, {"tst", BI_OPERAND}, {"teq", BI_OPERAND}, {"cmp", BI_OPERAND}, {"cmn", BI_OPERAND},
+
+    // tri-operand instructions
+    {"and", TRI_OPERAND}, {"eor", TRI_OPERAND}, {"sub", TRI_OPERAND}, {"rsb", TRI_OPERAND}, {"add", TRI_OPERAND}, 
+    {"adc", TRI_OPERAND}, {"sbc", TRI_OPERAND}, {"rsc", TRI_OPERAND}, {"orr", TRI_OPERAND}, {"bic", TRI_OPERAND}, 
+
+    // shift instructions
+    {"lsl", SHIFT}, {"lsr", SHIFT}, {"asr", SHIFT}, {"ror", SHIFT},
+    
+    //load/store instructions
+    {"ldr", LOAD_STORE}, {"str", LOAD_STORE},
+
+    // branch instructions
+    {"bx", BRANCH}, {"bl", BRANCH}, { "b", BRANCH}
+  });
+
+  /**
+   * The operation which a word starts with, taking the longest match so that e.g. "bl" is not read as "b".
+   */
+  constexpr std::optional<std::pair<std::string_view, TOKEN>> operation(std::string_view word) {
+    std::optional<std::pair<std::string_view, TOKEN>> match;
+    for (auto const& op : operations) {
+      if (word.starts_with(op.first) && (!match || op.first.size() > match->first.size())) match = op;
+    }
+    return match;
   }
 
+  inline constexpr const char* tokenNames[] = {
+    "LABEL",
+    "DIRECTIVE",
+
+    "BRANCH",
+    "BI_OPERAND",
+    "TRI_OPERAND",
+    "LOAD_STORE",
+    "SHIFT",
+
+    "REGISTER",
+    "IMM_BIN",
+    "IMM_OCT",
+    "IMM_DEC",
+    "IMM_HEX",
+    "VARIABLE",
+    "OP_LABEL",
+
+    "STRING",
+    "BIN",
+    "OCT",
+    "DEC",
+    "HEX",
+
+    "COMMA",
+    "OPEN_SQR",
+    "CLOSE_SQR",
+    "EXCLAMATION",
+    
+    "END",
+    "ERROR"
+  };
+
+  /**
+   * A single lexed token. Tokens are copied around a great deal, so they are kept small and trivially copyable:
+   * the lexer decodes each token up front into a payload which holds the register number, the immediate value,
+   * the operation and its suffixes, the punctuation character, or the symbol of a name. Only names, and text such
+   * as strings which cannot be rebuilt, are interned; the text of every other token is rebuilt from its payload.
+   */
   class Token {
     public:
-      Token();
-      Token(int, std::string, unsigned int lineNumber = 0, unsigned int tokenNumber = 0);
-      Token(TOKEN, std::string, unsigned int lineNumber = 0, unsigned int tokenNumber = 0);
-      TOKEN type() const { return m_type; };
-      std::string value() const { return m_value; };
+      Token() = default;
+      Token(int, std::string&, unsigned int lineNumber = 0, unsigned int tokenNumber = 0);
+      Token(TOKEN, std::string_view, unsigned int lineNumber = 0, unsigned int tokenNumber = 0);
+      TOKEN type() const { return static_cast<TOKEN>(m_type); };
+      std::string value() const;
+      size_t size() const;                                                    // the length of the text as it was lexed
       unsigned int lineNumber() const { return m_lineNumber; };
       unsigned int tokenNumber() const { return m_tokenNumber; };
+      unsigned int reg() const { return m_payload; };                         // r0 to r12, then sp, lr and pc
+      uint64_t immediate() const { return (uint64_t(m_high) << 32) | m_payload; };
+      Symbol symbol() const { return static_cast<Symbol>(m_payload); };       // label or variable name without its punctuation
+      std::tuple<std::string_view, std::string_view, std::string_view> mnemonic() const;     // operation, modifier and condition
+      void relocate(unsigned int lineNumber) { m_lineNumber = lineNumber; };
 
     private:
-      TOKEN m_type;
-      std::string m_value;
-      unsigned int m_lineNumber;
-      unsigned int m_tokenNumber;
-      TOKEN tokenType(int, std::string&);
+      uint8_t m_type = ERROR;
+      uint8_t m_length = 0;                 // of the lexed text, up to 255, for tokens whose text is rebuilt
+      uint16_t m_tokenNumber = 0;
+      uint32_t m_lineNumber = 0;
+      uint32_t m_high = 0;                  // the top half of a 64-bit immediate
+      uint32_t m_payload = 0;
+      static TOKEN tokenType(int, std::string&);
+      void decode(std::string_view);
   };
+
+  static_assert(sizeof(Token) == 16 && std::is_trivially_copyable_v<Token>);
 }
 
 
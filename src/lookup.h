@@ -0,0 +1,39 @@
+/**
+ * @file lookup.h
+ * Helpers for the constant tables which translate source text into enums. Tables are constexpr arrays of
+ * name/value pairs, so they are built by the compiler rather than at startup and exist once in the program.
+ */
+
+#ifndef IRISC_LOOKUP_H
+#define IRISC_LOOKUP_H
+
+#include <array>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace lookup {
+
+  template <typename T, size_t N>
+  using Table = std::array<std::pair<std::string_view, T>, N>;
+
+  /**
+   * The value for a name, or nothing if the table doesn't have it. The tables are small enough that a linear
+   * scan is quicker than anything cleverer.
+   */
+  template <typename T, size_t N>
+  constexpr std::optional<T> find(const Table<T, N>& table, std::string_view name) {
+    for (auto const& [key, value] : table) {
+      if (key == name) return value;
+    }
+    return std::nullopt;
+  }
+
+  template <typename T, size_t N>
+  constexpr bool contains(const Table<T, N>& table, std::string_view name) {
+    return find(table, name).has_value();
+  }
+
+}
+
+#endif //IRISC_LOOKUP_H
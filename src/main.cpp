@@ -3,6 +3,10 @@
 #include <fstream>
 #include <regex>
 #include <iomanip>
+#include <optional>
+#include <string>
+#include <cstdio>
+#include <unistd.h>
 #include <FL/Fl.H>
 
 #include "emulator/emulator.h"
@@ -15,29 +19,54 @@
 #define STR(x)   #x
 #define SHOW_DEFINE(x) printf("%s=%s\n", #x, STR(x))
 
-int main() {
-    SHOW_DEFINE(FL_ABI_VERSION);
+int main(int argc, char* argv[]) {
+    std::optional<std::string> script;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--script" && i + 1 < argc) script = argv[++i];
+    }
+
+    std::ifstream file;
+    if (script) {
+        file.open(*script);
+        if (!file) {
+            std::cerr << "Could not open script '" << *script << "'." << std::endl;
+            return 1;
+        }
+    }
+
+    bool scripted = script || !isatty(fileno(stdin));       // piped input is run as a script too
+    if (scripted) std::ios::sync_with_stdio(false);
+    else SHOW_DEFINE(FL_ABI_VERSION);
 
     Fl::lock();
     vm::Emulator emulator;
     replxx::Replxx rx;
     ui::REPL repl(rx);
-    std::thread repl_t(&ui::REPL::loop, repl, std::ref(emulator));
+    int errors = 0;
+    static int finished;                // the message which wakes the main loop once a script has ended
+    std::thread repl_t([&]{
+        if (!scripted) return repl.loop(emulator);
+        errors = script ? repl.script(file, emulator) : repl.script(std::cin, emulator);
+        Fl::awake(&finished);
+    });
 
     while (true) {
         Fl::wait();
-        if (Fl::thread_message()) {
-            repl_t.detach();
-            repl_t.~thread();
-            break;
-        }
+        if (Fl::thread_message()) break;
     }
 
-    if (repl_t.joinable()) repl_t.join();
+    // a script always runs to its end, so its error count is read once it has, but the interactive REPL may
+    // still be waiting for input when the windows are closed
+    if (scripted) repl_t.join();
+    else repl_t.detach();
+
+    Fl::unlock();
+    emulator.shutdown();                // the emulator thread may need the FLTK lock to finish its instruction
+    Fl::lock();
 
     // final cleanup
     while(Fl::first_window()) delete Fl::first_window();
-    std::cout << "\nGoodbye" << std::endl;
+    if (!scripted) std::cout << "\nGoodbye" << std::endl;
 
-    return 0;
+    return errors ? 1 : 0;
 }
@@ -1,7 +1,8 @@
 /**
  * @file syntax/constants.h
- * Holds various enums useful for translating tokens into machine code. Also holds maps which are used as 
- * look up tables to quickly generate explanations and titles for syntax and machine code.
+ * Holds various enums useful for translating tokens into machine code. Also holds constant tables which map
+ * source text onto the enums, and arrays indexed by the enums which hold titles and explanations for syntax
+ * and machine code.
  * @author Rory Pinkney
  * @date 28/10/20
  */
@@ -9,8 +10,9 @@
 #ifndef IRISC_SYNTAX_CONSTANTS_H
 #define IRISC_SYNTAX_CONSTANTS_H
 
-#include <map>
-#include <variant>
+#include <cstddef>
+#include <string_view>
+#include "../lookup.h"
 
 namespace syntax {
 
@@ -27,7 +29,7 @@ namespace syntax {
     B   = 32,  BL, BX
   };
 
-  static std::map<std::string, OPERATION> opMap {
+  inline constexpr auto opMap = std::to_array<std::pair<std::string_view, OPERATION>>({
     // arithmetic instructions
     {"and", AND}, {"eor", EOR}, {"sub", SUB}, {"rsb", RSB},
     {"add", ADD}, {"adc", ADC}, {"sbc", SBC}, {"rsc", RSC},
@@ -39,36 +41,36 @@ namespace syntax {
 
     // branch instructions
     {"bx",  BX }, {"bl",  BL }, { "b",  B  }
+  });
+
+  inline constexpr const char* opTitle[16] = {
+    "Bitwise AND", "Bitwise XOR", 
+    "Subtraction", "Reverse Subtraction",
+    "Addition", "Add with Carry",
+    "Subtract with Carry", "Reverse Subtraction with Carry",
+    "Test", "Test Equivalence",
+    "Compare", "Compare Negative",
+    "Bitwise OR", "Move",
+    "Bit Clear", "Move Negative"
   };
 
-  static std::map<OPERATION, std::string> opTitle {
-    {AND, "Bitwise AND"}, {EOR, "Bitwise XOR"}, 
-    {SUB, "Subtraction"}, {RSB, "Reverse Subtraction"},
-    {ADD, "Addition"}, {ADC, "Add with Carry"},
-    {SBC, "Subtract with Carry"}, {RSC, "Reverse Subtraction with Carry"},
-    {TST, "Test"}, {TEQ, "Test Equivalence"},
-    {CMP, "Compare"}, {CMN, "Compare Negative"},
-    {ORR, "Bitwise OR"}, {MOV, "Move"},
-    {BIC, "Bit Clear"}, {MVN, "Move Negative"}
-  };
-
-  static std::map<OPERATION, std::string> opExplain {
-    {AND, "Performs a bitwise AND operation and stores the result."}, 
-    {EOR, "Performs a bitwise exclusive OR operation and stores the result."}, 
-    {SUB, "Performs an arithmetic subtraction from left to right and stores the result."}, 
-    {RSB, "Performs an arithmetic subtraction from right to left and stores the result."},
-    {ADD, "Performs an arithmetic addition and stores the result."}, 
-    {ADC, "???"},
-    {SBC, "???"}, 
-    {RSC, "???"},
-    {TST, "Performs a bitwise AND operation, sets the CPSR flags and discards the result."},
-    {TEQ, "Performs a bitwise XOR operation, sets the CPSR flags and discards the result."},
-    {CMP, "Performs an arithmetic subtraction, sets the CPSR flags and discards the result."},
-    {CMN, "Performs an arithmetic addition, sets the CPSR flags and discards the result."},
-    {ORR, "Performs a bitwise OR operation and stores the result."},
-    {MOV, "Stores the second operand value in the destination register."},
-    {BIC, "Performs a bitwise AND operation with the complement of the second operand."},
-    {MVN, "Stores the additive inverse of the second operand value in the destination register."}
+  inline constexpr const char* opExplain[16] = {
+    "Performs a bitwise AND operation and stores the result.", 
+    "Performs a bitwise exclusive OR operation and stores the result.", 
+    "Performs an arithmetic subtraction from left to right and stores the result.", 
+    "Performs an arithmetic subtraction from right to left and stores the result.",
+    "Performs an arithmetic addition and stores the result.", 
+    "???",
+    "???", 
+    "???",
+    "Performs a bitwise AND operation, sets the CPSR flags and discards the result.",
+    "Performs a bitwise XOR operation, sets the CPSR flags and discards the result.",
+    "Performs an arithmetic subtraction, sets the CPSR flags and discards the result.",
+    "Performs an arithmetic addition, sets the CPSR flags and discards the result.",
+    "Performs a bitwise OR operation and stores the result.",
+    "Stores the second operand value in the destination register.",
+    "Performs a bitwise AND operation with the complement of the second operand.",
+    "Stores the additive inverse of the second operand value in the destination register."
   };
 
 
@@ -78,40 +80,40 @@ namespace syntax {
     EQ, NE, CS, CC, MI, PL, VS, VC, HI, LS, GE, LT, GT, LE, AL
   };
 
-  static std::map<std::string, CONDITION> condMap {
+  inline constexpr auto condMap = std::to_array<std::pair<std::string_view, CONDITION>>({
     {"eq", EQ}, {"ne", NE}, {"cs", CS}, {"cc", CC},
     {"mi", MI}, {"pl", PL}, {"vs", VS}, {"vc", VC},
     {"hi", HI}, {"ls", LS}, {"ge", GE}, {"lt", LT}, 
     {"gt", GT}, {"le", LE}, {"al", AL}, { "" , AL}
+  });
+
+  inline constexpr const char* condTitle[15] = {
+    "Equal", "Not Equal", 
+    "Unsigned More Than or Equal to", "Unsigned Less Than",
+    "Negative", "Positive or Zero",
+    "Overflow", "No Overflow",
+    "Unsigned More Than", "Unsigned Less Than or Equal to",
+    "Signed More Than or Equal to", "Signed Less Than",
+    "Signed More Than", "Signed Less Than or Equal to",
+    "Always"
   };
 
-  static std::map<CONDITION, std::string> condTitle {
-    {EQ, "Equal"}, {NE, "Not Equal"}, 
-    {CS, "Unsigned More Than or Equal to"}, {CC, "Unsigned Less Than"},
-    {MI, "Negative"}, {PL, "Positive or Zero"},
-    {VS, "Overflow"}, {VC, "No Overflow"},
-    {HI, "Unsigned More Than"}, {LS, "Unsigned Less Than or Equal to"},
-    {GE, "Signed More Than or Equal to"}, {LT, "Signed Less Than"},
-    {GT, "Signed More Than"}, {LE, "Signed Less Than or Equal to"},
-    {AL, "Always"}
-  };
-
-  static std::map<CONDITION, std::string> condExplain {
-    {EQ, "The instruction is only executed if the zero flag (Z) is set."}, 
-    {NE, "The instruction is only executed if the zero flag (Z) is clear."}, 
-    {CS, "The instruction is only executed if the carry flag (C) is set."}, 
-    {CC, "The instruction is only executed if the carry flag (C) is clear."},
-    {MI, "The instruction is only executed if the negative flag (N) is set."}, 
-    {PL, "The instruction is only executed if the negative flag (N) is clear."},
-    {VS, "The instruction is only executed if the overflow flag (V) is set."}, 
-    {VC, "The instruction is only executed if the overflow flag (V) is clear."},
-    {HI, "The instruction is only executed if the carry flag (C) is set AND the zero flag (Z) is clear."},
-    {LS, "The instruction is only executed if the carry flag (C) is clear OR the zero flag (Z) is set."},
-    {GE, "The instruction is only executed if the negative flag (N) and the overflow flag (V) are the same."},
-    {LT, "The instruction is only executed if the negative flag (N) and the overflow flag (V) are different."},
-    {GT, "The instruction is only executed if the zero flag (Z) is clear and the negative (N) and overflow (V) flags are the same."},
-    {LE, "The instruction is only executed if the zero flag (Z) is set and the negative (N) and overflow (V) flags are different."},
-    {AL, "The instruction is executed unconditionally. This is the default condition."}
+  inline constexpr const char* condExplain[15] = {
+    "The instruction is only executed if the zero flag (Z) is set.", 
+    "The instruction is only executed if the zero flag (Z) is clear.", 
+    "The instruction is only executed if the carry flag (C) is set.", 
+    "The instruction is only executed if the carry flag (C) is clear.",
+    "The instruction is only executed if the negative flag (N) is set.", 
+    "The instruction is only executed if the negative flag (N) is clear.",
+    "The instruction is only executed if the overflow flag (V) is set.", 
+    "The instruction is only executed if the overflow flag (V) is clear.",
+    "The instruction is only executed if the carry flag (C) is set AND the zero flag (Z) is clear.",
+    "The instruction is only executed if the carry flag (C) is clear OR the zero flag (Z) is set.",
+    "The instruction is only executed if the negative flag (N) and the overflow flag (V) are the same.",
+    "The instruction is only executed if the negative flag (N) and the overflow flag (V) are different.",
+    "The instruction is only executed if the zero flag (Z) is clear and the negative (N) and overflow (V) flags are the same.",
+    "The instruction is only executed if the zero flag (Z) is set and the negative (N) and overflow (V) flags are different.",
+    "The instruction is executed unconditionally. This is the default condition."
   };
 
 
@@ -121,31 +123,31 @@ namespace syntax {
     R0, R1, R2, R3, R4, R5, R6, R7, R8, R9, R10, R11, R12, SP, LR, PC
   };
 
-  static std::map<std::string, REGISTER> regMap {
+  inline constexpr auto regMap = std::to_array<std::pair<std::string_view, REGISTER>>({
     { "r0", R0 }, { "r1", R1 }, { "r2", R2 }, { "r3", R3 },
     { "r4", R4 }, { "r5", R5 }, { "r6", R6 }, { "r7", R7 },
     { "r8", R8 }, { "r9", R9 }, {"r10", R10}, {"r11", R11}, 
     {"r12", R12}, { "sp", SP }, { "lr", LR }, { "pc", PC }
-  };
+  });
 
-  static std::map<REGISTER, std::string> regTitle {
-    {R0, "Register 0"}, {R1, "Register 1"}, {R2, "Register 2"}, {R3, "Register 3"}, 
-    {R4, "Register 4"}, {R5, "Register 5"}, {R6, "Register 6"}, {R7, "Register 7"}, 
-    {R8, "Register 8"}, {R9, "Register 9"}, {R10, "Register 10"}, {R11, "Register 11"},  
-    {R12, "Register 12"}, {SP, "Stack Pointer"}, {LR, "Link Register"}, {PC, "Program Counter"}, 
+  inline constexpr const char* regTitle[16] = {
+    "Register 0", "Register 1", "Register 2", "Register 3", 
+    "Register 4", "Register 5", "Register 6", "Register 7", 
+    "Register 8", "Register 9", "Register 10", "Register 11",  
+    "Register 12", "Stack Pointer", "Link Register", "Program Counter", 
   };
 
-  static std::map<REGISTER, std::string> regExplain {
-    {R0, "General Purpose Register\n"}, {R1, "General Purpose Register\n"}, 
-    {R2, "General Purpose Register\n"}, {R3, "General Purpose Register\n"}, 
-    {R4, "General Purpose Register\n"}, {R5, "General Purpose Register\n"}, 
-    {R6, "General Purpose Register\n"}, {R7, "General Purpose Register\n"}, 
-    {R8, "General Purpose Register\n"}, {R9, "General Purpose Register\n"}, 
-    {R10, "General Purpose Register\n"}, {R11, "General Purpose Register\n"},  
-    {R12, "General Purpose Register\n"}, 
-    {SP, "The memory address for the top of the stack."}, 
-    {LR, "The return address of the current function."}, 
-    {PC, "The memory address of the current instruction."}, 
+  inline constexpr const char* regExplain[16] = {
+    "General Purpose Register\n", "General Purpose Register\n", 
+    "General Purpose Register\n", "General Purpose Register\n", 
+    "General Purpose Register\n", "General Purpose Register\n", 
+    "General Purpose Register\n", "General Purpose Register\n", 
+    "General Purpose Register\n", "General Purpose Register\n", 
+    "General Purpose Register\n", "General Purpose Register\n",  
+    "General Purpose Register\n", 
+    "The memory address for the top of the stack.", 
+    "The return address of the current function.", 
+    "The memory address of the current instruction.", 
   };
 
 
@@ -155,13 +157,13 @@ namespace syntax {
     LSL, LSR, ASR, ROR
   };
 
-  static std::map<std::string, SHIFT> shiftMap {
+  inline constexpr auto shiftMap = std::to_array<std::pair<std::string_view, SHIFT>>({
     {"lsl", LSL}, {"lsr", LSR}, {"asr", ASR}, {"ror", ROR}
-  };
+  });
 
-  static std::map<SHIFT, std::string> shiftTitle {
-    {LSL, "Logical Shift Left"}, {LSR, "Logical Shift Right"}, 
-    {ASR, "Arithmetic Shift Right"}, {ROR, "Rotate Right"}
+  inline constexpr const char* shiftTitle[4] = {
+    "Logical Shift Left", "Logical Shift Right", 
+    "Arithmetic Shift Right", "Rotate Right"
   };
 
 
@@ -171,36 +173,78 @@ namespace syntax {
     BYTE, HALFWORD, WORD
   };
 
-  static std::map<std::string, SIZE> sizeMap {
+  inline constexpr auto sizeMap = std::to_array<std::pair<std::string_view, SIZE>>({
     { "b", BYTE }, { "h", HALFWORD }
-  };
+  });
 
 
   //*******************************************************************************************
   // CPSR FLAGS
-  static std::string flagsExplain[] = {
+  inline constexpr const char* flagsExplain[] = {
     "Do not set the CPSR flags based on the result of this instruction.",
     "Set the CPSR flags based on the result of this instruction."
   };
 
 
   //*******************************************************************************************
-  // TYPE DIRECTIVES
-  static std::map<std::string, std::variant<std::monostate, uint8_t, uint16_t, uint32_t, std::string>> typeMap {
-    { ".skip", std::monostate() }, { ".ascii", std::string() }, 
-    { ".asciz", std::string() }, { ".string", std::string() },
-    { ".byte", uint8_t() }, { ".hword", uint16_t() },
-    { ".word", uint32_t() }
+  // MACHINE CODE FIELDS
+  enum FIELD {
+    CONDITION_CODE, INSTRUCTION_TYPE, OPERATION_CODE, CPSR_FLAGS, SECOND_UNUSED, SECOND_OPERAND, FIRST_OPERAND,
+    BARREL_SHIFT, IMMEDIATE_VALUE, SHIFT_REGISTER, SHIFT_OPERATION, SHIFT_BY_REGISTER, SHIFT_AMOUNT, 
+    SHIFT_BY_IMMEDIATE, NO_SHIFT, FLEXIBLE_OPERAND, BRANCH_TYPE, BRANCH_LINK, BRANCH_OFFSET, BRANCH_EXCHANGE,
+    BRANCH_REGISTER
   };
 
+  // Title and width of each field. Details which depend on the instruction are null here and filled in by its node.
+  struct FieldInfo {
+    const char* title;
+    unsigned int width;
+    const char* detail;
+  };
+
+  inline constexpr FieldInfo fieldInfo[] = {
+    { "Condition Code", 4, nullptr },
+    { "Instruction Type", 3, "Arithmetic Operation. Indicates the organisation of bits to the processor so that the instruction can be decoded." },
+    { "Operation Code", 4, nullptr },
+    { "CPSR Flags", 1, nullptr },
+    { "Second Operand", 4, "Unused. These bits are left unset because the instruction only has two operands." },
+    { "Second Operand", 4, nullptr },
+    { "First Operand", 4, nullptr },
+    { "Barrel Shifter", 4, "The amount by which the eight bit immediate value is rotated right." },
+    { "Immediate", 8, "An eight bit immediate value. This value, along with the barrel shift, forms the second operand." },
+    { "Optional Shift Amount", 4, nullptr },
+    { "Optional Shift Operation", 2, nullptr },
+    { "Optional Shift Type", 1, "The flexible operand is optionally shifted by a register value." },
+    { "Optional Shift Amount", 5, nullptr },
+    { "Optional Shift Type", 1, "The flexible operand is optionally shifted by an immediate value." },
+    { "No Optional Shift", 8, "The flexible operand is not optionally shifted." },
+    { "Flexible Operand", 4, nullptr },
+    { "Instruction Type", 3, "Branch. Indicates the organisation of bits to the processor so that the instruction can be decoded." },
+    { "Link", 1, nullptr },
+    { "Offset", 24, nullptr },
+    { "Instruction Type", 24, nullptr },
+    { "Target Register", 4, nullptr }
+  };
+
+
+  //*******************************************************************************************
+  // TYPE DIRECTIVES
+  // the value is the alternative of AllocationNode::value() which the directive allocates
+  inline constexpr auto typeMap = std::to_array<std::pair<std::string_view, size_t>>({
+    { ".skip", 0 }, { ".ascii", 4 }, 
+    { ".asciz", 4 }, { ".string", 4 },
+    { ".byte", 1 }, { ".hword", 2 },
+    { ".word", 3 }
+  });
+
   // DIRECTIVES
   enum DIRECTIVE {
     TEXT, DATA, GLOBAL
   };
 
-  static std::map<std::string, DIRECTIVE> directiveMap = {
+  inline constexpr auto directiveMap = std::to_array<std::pair<std::string_view, DIRECTIVE>>({
     { ".text", TEXT }, { ".data", DATA }, { ".global", GLOBAL }
-  };
+  });
 
 
   //******************************************************************************************
@@ -4,59 +4,110 @@
 #include <iostream>
 #include <variant>
 #include <typeinfo>
+#include <type_traits>
+#include <utility>
 
 using namespace parser;
 
 Parser::Parser(lexer::Lexer& lexer) : lexer(lexer) {}
 
 syntax::Node* Parser::parseSingle() {
-  std::vector<lexer::Token> statement;
+  if (!scan()) 
+    return nullptr;                                 // safely return nullptr which can be caught and dealt with
+
+  return parseStatement(statement);
+}
+
+/**
+ * Parses the next statement into a node held by the caller, leaving it empty if there is no statement. The tokens
+ * of the statement previously held there are recycled, so parsing one statement after another does not allocate.
+ */
+void Parser::parseSingle(syntax::Statement& node) {
+  if (!node.valueless_by_exception())
+    if (syntax::Node* previous = syntax::node(node)) statement = previous->release();   // reuse the previous statement's storage
+
+  if (!scan()) node = std::monostate();
+  else parseStatement(std::move(statement), node);
+}
+
+/**
+ * Collects the tokens of the next statement into the scratch buffer, which keeps its capacity between statements.
+ */
+bool Parser::scan() {
+  statement.clear();
   while (lexer.peekToken().type() != lexer::END && lexer.peekToken().type() != lexer::ERROR) {
     statement.push_back(lexer.nextToken());
   }
 
-  if (statement.empty()) 
-    return nullptr;                                 // safely return nullptr which can be caught and dealt with
+  return !statement.empty();
+}
 
+/**
+ * Builds the syntax node for a single statement which has already been split into tokens.
+ */
+syntax::Node* Parser::parseStatement(std::vector<lexer::Token> statement) {
+  syntax::Statement node;
+  parseStatement(std::move(statement), node);
+
+  return std::visit([](auto& node) -> syntax::Node* {
+    using T = std::decay_t<decltype(node)>;
+    if constexpr (std::is_same_v<T, std::monostate>) return nullptr;
+    else return new T(std::move(node));
+  }, node);
+}
+
+/**
+ * Builds the syntax node for a single statement in place.
+ */
+void Parser::parseStatement(std::vector<lexer::Token> statement, syntax::Statement& node) {
   if (statement[0].type() == lexer::BI_OPERAND) 
-    return new syntax::BiOperandNode(statement);
+    node.emplace<syntax::BiOperandNode>(std::move(statement));
   
-  if (statement[0].type() == lexer::TRI_OPERAND) 
-    return new syntax::TriOperandNode(statement);
+  else if (statement[0].type() == lexer::TRI_OPERAND) 
+    node.emplace<syntax::TriOperandNode>(std::move(statement));
   
-  if (statement[0].type() == lexer::SHIFT)
-    return new syntax::ShiftNode(statement);
+  else if (statement[0].type() == lexer::SHIFT)
+    node.emplace<syntax::ShiftNode>(std::move(statement));
 
-  if (statement[0].type() == lexer::BRANCH)
-    return new syntax::BranchNode(statement);
+  else if (statement[0].type() == lexer::BRANCH)
+    node.emplace<syntax::BranchNode>(std::move(statement));
 
-  if (statement[0].type() == lexer::LABEL) {
-    if (statement.size() == 1) return new syntax::LabelNode(statement);
-    else return new syntax::AllocationNode(statement);
+  else if (statement[0].type() == lexer::LABEL) {
+    if (statement.size() == 1) node.emplace<syntax::LabelNode>(std::move(statement));
+    else node.emplace<syntax::AllocationNode>(std::move(statement));
   }
 
-  if (statement[0].type() == lexer::DIRECTIVE) {
-    return new syntax::DirectiveNode(statement);
+  else if (statement[0].type() == lexer::DIRECTIVE) {
+    node.emplace<syntax::DirectiveNode>(std::move(statement));
   }
     // throw RuntimeError("Label statement is not executable", statement, 0);
   // if (statement[0].type() == lexer::LOAD_STORE)
   //   return new syntax::LoadStoreNode(statement);
 
-  if (statement[0].type() == lexer::OP_LABEL) {
+  else if (statement[0].type() == lexer::OP_LABEL) {
     throw SyntaxError("Invalid label-like token detected, did you forget a colon?", statement, 0);
   }
 
-  throw SyntaxError("Unrecognised instruction", statement, 0);
+  else throw SyntaxError("Unrecognised instruction", statement, 0);
 }
 
-std::vector<syntax::Node*> Parser::parseMultiple() {
-  std::vector<syntax::Node*> nodes;
+/**
+ * Parses the next non-empty statement, skipping blank lines. Returns nullptr once the token stream is exhausted.
+ */
+syntax::Node* Parser::parseNext() {
   while (lexer.peekToken().type() != lexer::ERROR) {
     while (lexer.peekToken().type() == lexer::END) lexer.nextToken();   // skip all newlines
-  
+
     syntax::Node* node = parseSingle();
-    if (node != nullptr) nodes.push_back(node);
+    if (node != nullptr) return node;
   }
 
+  return nullptr;
+}
+
+std::vector<syntax::Node*> Parser::parseMultiple() {
+  std::vector<syntax::Node*> nodes;
+  while (syntax::Node* node = parseNext()) nodes.push_back(node);
+
   return nodes;
 }
\ No newline at end of file
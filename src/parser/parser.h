@@ -23,11 +23,15 @@ namespace parser {
       // void advanceToken();
 
       syntax::Node* parseSingle();
+      void parseSingle(syntax::Statement&);
+      static syntax::Node* parseStatement(std::vector<lexer::Token>);
+      static void parseStatement(std::vector<lexer::Token>, syntax::Statement&);
+      syntax::Node* parseNext();
       std::vector<syntax::Node*> parseMultiple();
     
-    // private:
-    //   syntax::Node parseSingle();
-    //   syntax::Node parseMultiple();
+    private:
+      std::vector<lexer::Token> statement;          // scratch space for the tokens of the current statement
+      bool scan();
   };
 }
 
@@ -4,8 +4,7 @@
 #include <iostream>
 #include <bitset>
 #include <bit>
-#include <cmath>
-#include <strings.h>
+#include <utility>
 
 using namespace syntax;
 
@@ -17,10 +16,10 @@ using namespace syntax;
  */
 Node::Node() = default;
 
-Node::Node(std::vector<lexer::Token> statement) : _statement(statement) {}
+Node::Node(std::vector<lexer::Token> statement) : _statement(std::move(statement)) {}
 
 Node::Node(std::vector<lexer::Token> statement, unsigned int currentToken) : 
-  _statement(statement), 
+  _statement(std::move(statement)), 
   currentToken(currentToken) 
 {}
 
@@ -29,13 +28,13 @@ Node::~Node() {}
 lexer::Token Node::nextToken() { 
   if (currentToken < _statement.size())
     return _statement[currentToken++];
-  else throw SyntaxError("Unexpected instruction end '" + _statement.back().value() + "'.", _statement, _statement.size() - 1);
+  else throw SyntaxError("Unexpected instruction end '" + std::string(_statement.back().value()) + "'.", _statement, _statement.size() - 1);
 }
 
 lexer::Token Node::peekToken() { 
   if (currentToken < _statement.size())
     return _statement[currentToken];
-  else throw SyntaxError("Unexpected instruction end '" + _statement.back().value() + "'.", _statement, _statement.size() - 1);
+  else throw SyntaxError("Unexpected instruction end '" + std::string(_statement.back().value()) + "'.", _statement, _statement.size() - 1);
 }
 
 bool Node::hasToken() {
@@ -43,7 +42,7 @@ bool Node::hasToken() {
   return false;
 }
 
-std::string Node::toString() {
+std::string Node::toString() const {
   std::string instruction = "";
   for (int i = 0; i < _statement.size(); i++) {
     std::stringstream oss;
@@ -56,41 +55,39 @@ std::string Node::toString() {
   return instruction;
 }
 
+/**
+ * Moves the statement to a different source line, e.g. when reusing a node parsed before lines above it were edited.
+ */
+void Node::relocate(unsigned int lineNumber) {
+  for (lexer::Token& token : _statement) token.relocate(lineNumber);
+}
+
 /**
  * Functions for parsing various tokens
  */
 bool Node::parseComma(lexer::Token token) {
   if (token.type() == lexer::COMMA) return true;
-  else throw SyntaxError("COMMA expected between operands - received " + lexer::tokenNames[token.type()] + " '" + token.value() + "', instead.", _statement, currentToken - 1);
+  else throw SyntaxError("COMMA expected between operands - received " + std::string(lexer::tokenNames[token.type()]) + " '" + std::string(token.value()) + "', instead.", _statement, currentToken - 1);
 }
 
 REGISTER Node::parseRegister(lexer::Token token) {
-  if (token.type() == lexer::REGISTER) return regMap[token.value()];
-  else throw SyntaxError("REGISTER expected - received " + lexer::tokenNames[token.type()] + " '" + token.value() + "' instead.", _statement, currentToken - 1);
+  if (token.type() == lexer::REGISTER) return static_cast<REGISTER>(token.reg());
+  else throw SyntaxError("REGISTER expected - received " + std::string(lexer::tokenNames[token.type()]) + " '" + std::string(token.value()) + "' instead.", _statement, currentToken - 1);
+}
+
+/**
+ * Checks the token type up front so that operands which may be either a register or an immediate do not
+ * need a thrown exception to rule one of them out.
+ */
+bool Node::isImmediate(lexer::Token token) {
+  return token.type() >= lexer::IMM_BIN && token.type() <= lexer::IMM_HEX;
 }
 
 uint64_t Node::parseImmediate(lexer::Token token) {
-  int base = 0;
-  int start;
-  if (token.type() == lexer::IMM_BIN) {
-    base = 2;
-    start = token.value().find_last_not_of("01");
-  }
-  else if (token.type() == lexer::IMM_OCT) {
-    base = 8;
-    start = token.value().find_last_not_of("01234567");
-  }
-  else if (token.type() == lexer::IMM_DEC) {
-    base = 10;
-    start = token.value().find_last_not_of("0123456789");
-  }
-  else if (token.type() == lexer::IMM_HEX) {
-    base = 16;
-    start = token.value().find_last_not_of("0123456789abcdef");
-  }
-  else throw SyntaxError("IMMEDIATE value expected - received " + lexer::tokenNames[token.type()] + " '" + token.value() + "' instead.", _statement, token.tokenNumber());
+  if (!isImmediate(token))
+    throw SyntaxError("IMMEDIATE value expected - received " + std::string(lexer::tokenNames[token.type()]) + " '" + std::string(token.value()) + "' instead.", _statement, token.tokenNumber());
 
-  return std::strtoull(token.value().substr(start + 1, token.value().size()).c_str(), nullptr, base);
+  return token.immediate();                                   // decoded by the lexer
 }
 
 /**
@@ -98,33 +95,25 @@ uint64_t Node::parseImmediate(lexer::Token token) {
  */
 uint32_t Node::parseImmediate(lexer::Token token, unsigned int bits) {
   uint64_t imm = parseImmediate(token);
-  if (imm < pow(2, bits)) return imm;
-  else throw NumericalError("IMMEDIATE value '" + token.value() + "' (decimal " + std::to_string(imm) + ") is greater than the " + std::to_string(bits) + "-bit maximum.", _statement, token.tokenNumber());
+  if ((imm >> bits) == 0) return imm;
+  else throw NumericalError("IMMEDIATE value '" + std::string(token.value()) + "' (decimal " + std::to_string(imm) + ") is greater than the " + std::to_string(bits) + "-bit maximum.", _statement, token.tokenNumber());
 }
 
 /**
- * Parse immediate value with maximum bit-width and ARMv7 barrel shift applied if necessary
+ * Parse an immediate second operand, which must be an eight bit value rotated right by an even amount. Returns
+ * the eight bit value and sets the number of bits it is rotated right by.
  */
-uint32_t Node::parseImmediate(lexer::Token token, unsigned int bits, unsigned int& immShift) {
+uint32_t Node::parseModifiedImmediate(lexer::Token token, unsigned int& immShift) {
   uint64_t imm = parseImmediate(token); 
-  if (imm == 0) return imm;                                   // return 0 if imm == 0 (short circuit)
-
-  // std::cout << std::bitset<64>(imm) << std::endl;
+  if (imm > UINT32_MAX)
+    throw NumericalError("IMMEDIATE value '" + std::string(token.value()) + "' (decimal " + std::to_string(imm) + ") cannot be represented in 32 bits.", _statement, token.tokenNumber());
 
-  int bottombit = ffs(imm) - 1;
-  int topbit = (int)std::log2(imm);
-  // std::cout << bottombit << ", " << topbit << std::endl;
-  if (topbit > 31)
-    throw NumericalError("IMMEDIATE value '" + token.value() + "' (decimal " + std::to_string(imm) + ") cannot be represented in 32 bits.", _statement, token.tokenNumber());
-  if ((topbit - bottombit) > --bits)
-    throw NumericalError("IMMEDIATE value '" + token.value() + "' (decimal " + std::to_string(imm) + ") cannot be implicitly represented with a maximum set-bit width of 8.", _statement, token.tokenNumber());
+  std::optional<ModifiedImmediate> encoded = encodeModifiedImmediate(imm);
+  if (!encoded)
+    throw NumericalError("IMMEDIATE value '" + std::string(token.value()) + "' (decimal " + std::to_string(imm) + ") cannot be represented as an 8-bit value rotated right by an even number of bits.", _statement, token.tokenNumber());
 
-  if (topbit > bits) { 
-    imm = std::rotr((uint32_t)imm, topbit - 7);
-    immShift = 32 - (topbit - 7);
-  }
-    
-  return imm;
+  immShift = 2 * encoded->rotate;
+  return encoded->imm;
 }
 
 /**
@@ -132,26 +121,46 @@ uint32_t Node::parseImmediate(lexer::Token token, unsigned int bits, unsigned in
  * Base class for all operation instructions. Contains implementations of common methods 
  * e.g. splitting the opcode into operation/modifier/condition.
  */
-InstructionNode::InstructionNode(std::vector<lexer::Token> statement) : Node(statement) {}
+InstructionNode::InstructionNode(std::vector<lexer::Token> statement) : Node(std::move(statement)) {}
 
-std::tuple<std::string, std::string, std::string> InstructionNode::splitOpCode(lexer::Token token) {
-  std::string operation;
-  std::string modifier;
-  std::string condition;
+/**
+ * The machine code for this instruction, assembled the first time it is asked for.
+ */
+const Encoding& InstructionNode::encoding() {
+  if (!_encoding) _encoding = encode();
+  return *_encoding;
+}
 
-  std::string forceFlags[] = {"cmp", "cmn", "tst", "teq"};    // operations that always set flags regardless of modifier value
+/**
+ * Encodes a data processing instruction. Rn is empty for instructions which only have two operands.
+ */
+Encoding InstructionNode::encodeArithmetic(std::optional<REGISTER> Rn, REGISTER Rd, const FlexOperand& flex) const {
+  Encoding encoding;
+  for (FIELD field : {CONDITION_CODE, INSTRUCTION_TYPE, OPERATION_CODE, CPSR_FLAGS}) encoding.add(field);
+  encoding.add(Rn ? SECOND_OPERAND : SECOND_UNUSED);
+  encoding.add(FIRST_OPERAND);
+
+  uint32_t operand2 = flex.encode(encoding);
+  encoding.word = syntax::encodeDataProcessing(_cond, _op, _setFlags, Rn.value_or(R0), Rd, operand2);
+  return encoding;
+}
 
-  using namespace lexer;
-  std::map<std::string, TOKEN>::reverse_iterator it = std::find_if(operations.rbegin(), operations.rend(), [token](const std::pair<std::string, TOKEN> op){ return token.value().substr(0, op.first.size()) == op.first; });
-  operation = it->first;
+/**
+ * Describes a field of the machine code for this instruction. Only called when the explanation is shown.
+ */
+std::string InstructionNode::explain(FIELD field) const {
+  switch (field) {
+    case CONDITION_CODE: return std::string(condTitle[_cond]) + ". " + condExplain[_cond];
+    case OPERATION_CODE: return std::string(opTitle[_op]) + ". " + opExplain[_op];
+    case CPSR_FLAGS: return flagsExplain[_setFlags];
+    default: return fieldInfo[field].detail ? fieldInfo[field].detail : "";
+  }
+}
 
-  std::string suffix = token.value().substr(operation.size(), token.value().size());
-  if (suffix.size() == 1 || suffix.size() == 3) {                                                       // valid operation suffixes are up to 3 letters long maximum
-    modifier = suffix[0];
-    suffix = suffix.substr(1, suffix.size());
-  }                                                      
-  condition = suffix;
+std::tuple<std::string_view, std::string_view, std::string_view> InstructionNode::splitOpCode(lexer::Token token) {
+  constexpr std::string_view forceFlags[] = {"cmp", "cmn", "tst", "teq"};    // operations that always set flags regardless of modifier value
 
+  auto [operation, modifier, condition] = token.mnemonic();
   if (std::find(std::begin(forceFlags), std::end(forceFlags), operation) != std::end(forceFlags)) modifier = "s";
 
   return {operation, modifier, condition};
@@ -162,29 +171,57 @@ std::tuple<std::string, std::string, std::string> InstructionNode::splitOpCode(l
  * BranchNode
  * Responsible for parsing and delegating parsing of branch instructions B, BL and BX
  */
-BranchNode::BranchNode(std::vector<lexer::Token> statement) : InstructionNode(statement) {
+BranchNode::BranchNode(std::vector<lexer::Token> statement) : InstructionNode(std::move(statement)) {
   std::cout << "parsing branch" << std::endl;
 
   auto [operation, modifier, condition] = splitOpCode(nextToken());
-  this->_op = opMap[operation];
+  this->_op = lookup::find(opMap, operation).value();
   this->_setFlags = false;
-  this->_cond = condMap[condition];
+  this->_cond = lookup::find(condMap, condition).value();
 
 
   if (peekToken().type() == lexer::REGISTER) 
     this->_Rd = parseRegister(peekToken());
 
   else if (peekToken().type() == lexer::OP_LABEL) 
-    this->_Rd = peekToken().value().substr(0, peekToken().value().size());
+    this->_Rd = peekToken().symbol();
 
-  else throw SyntaxError("Expected either REGISTER or LABEL value - received " + lexer::tokenNames[peekToken().type()] + " '" + peekToken().value() + "' instead.", statement, currentToken);
+  else throw SyntaxError("Expected either REGISTER or LABEL value - received " + std::string(lexer::tokenNames[peekToken().type()]) + " '" + std::string(peekToken().value()) + "' instead.", _statement, currentToken);
   
   nextToken();
-  if (hasToken()) throw SyntaxError("Unexpected token '" + peekToken().value() + "' after valid instruction end.", statement, peekToken().tokenNumber());
+  if (hasToken()) throw SyntaxError("Unexpected token '" + std::string(peekToken().value()) + "' after valid instruction end.", _statement, peekToken().tokenNumber());
 }
 
-std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> BranchNode::assemble() {
-  return {0, {{"", "", 0}}};
+/**
+ * Encodes a branch to a label as an offset from the PC, or a branch to a register as a branch and exchange.
+ */
+Encoding BranchNode::encode() const {
+  Encoding encoding;
+  encoding.add(CONDITION_CODE);
+  if (!toLabel()) {
+    encoding.add(BRANCH_EXCHANGE);
+    encoding.add(BRANCH_REGISTER);
+    encoding.word = encodeBranchExchange(_cond, _op == BL, std::get<REGISTER>(_Rd));
+    return encoding;
+  }
+
+  for (FIELD field : {BRANCH_TYPE, BRANCH_LINK, BRANCH_OFFSET}) encoding.add(field);
+  encoding.word = encodeBranch(_cond, _op == BL, offset());
+  return encoding;
+}
+
+std::string BranchNode::explain(FIELD field) const {
+  switch (field) {
+    case BRANCH_LINK: return _op == BL 
+      ? "Branch with link. The address of the next instruction is saved in the link register so that the branch can be returned from." 
+      : "Branch without link. The link register is left as it is.";
+    case BRANCH_OFFSET: return "The label '" + std::string(lexer::name(label())) + "' is " + std::to_string(offset()) + " instructions away, counted from two instructions after this one because the PC reads ahead.";
+    case BRANCH_EXCHANGE: return _op == BL 
+      ? "Branch with link to the address in a register. Indicates the organisation of bits to the processor so that the instruction can be decoded." 
+      : "Branch to the address in a register. Indicates the organisation of bits to the processor so that the instruction can be decoded.";
+    case BRANCH_REGISTER: return std::string(regTitle[std::get<REGISTER>(_Rd)]) + ". The address of the instruction to branch to.";
+    default: return InstructionNode::explain(field);
+  }
 }
 
 
@@ -192,86 +229,30 @@ std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> Bra
  * BiOperandNode
  * Responsible for parsing and delegating parsing of a binary operand instruction in ARMv7 assembly.
  */
-BiOperandNode::BiOperandNode(std::vector<lexer::Token> statement) : InstructionNode(statement) {
+BiOperandNode::BiOperandNode(std::vector<lexer::Token> statement) : InstructionNode(std::move(statement)) {
   auto [operation, modifier, condition] = splitOpCode(nextToken());
-  this->_op = opMap[operation];
+  this->_op = lookup::find(opMap, operation).value();
   this->_setFlags = modifier.empty() ? false : true;
-  this->_cond = condMap[condition];
+  this->_cond = lookup::find(condMap, condition).value();
 
   this->_Rd = parseRegister(nextToken());
 
   peekToken();                                              // peek next token to see if it exists
-  this->_flex = FlexOperand(statement, currentToken);          // parsing delegated to FlexOperand
+  this->_flex = FlexOperand(std::move(_statement), currentToken);   // parsing delegated to FlexOperand, which borrows the tokens
+  this->_statement = _flex.release();
 }
 
 /**
- * Assembles this instruction into the proper machine code that would execute it on an ARM device.
+ * Encodes this instruction into the proper machine code that would execute it on an ARM device.
  */
-std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> BiOperandNode::assemble() {
-  uint32_t instruction = 0;
-  std::vector<std::tuple<std::string, std::string, int>> explanation;
-
-  instruction = (instruction << 4) | _cond;
-  explanation.push_back({"Condition Code", condTitle[_cond] + ". " + condExplain[_cond], 4});
-
-  instruction <<= 3;                // logical shift left 8 for data processing
-  explanation.push_back({"Instruction Type", "Arithmetic Operation. Indicates the organisation of bits to the processor so that the instruction can be decoded.", 3});
-
-  instruction = (instruction << 4) | _op;
-  explanation.push_back({"Operation Code", opTitle[_op] + ". " + opExplain[_op], 4});
-
-  instruction = (instruction << 1) | _setFlags;
-  explanation.push_back({"CPSR Flags", flagsExplain[_setFlags], 1});
-
-  instruction <<= 4;
-  explanation.push_back({"Second Operand", "Unused. These bits are left unset because the instruction only has two operands.", 4});
-
-  instruction = (instruction << 4) | _Rd;
-  explanation.push_back({"First Operand", regTitle[_Rd] + ". The first operand is often referred to as the 'destination' register.", 4});
-
-  if (_flex.isImm()) {                                                                          // operand is immediate
-    int imm = std::get<int>(_flex.Rm());
-    instruction = (instruction << 4) | _flex.immShift();
-    explanation.push_back({"Barrel Shifter", "The amount by which the eight bit immediate value is rotated right.", 4});
-    instruction = (instruction << 8) | imm;
-    explanation.push_back({"Immediate", "An eight bit immediate value. This value, along with the barrel shift, forms the second operand.", 8});
-  }
-  else if (_flex.isReg()) {                                                                     // operand is register
-    if (_flex.shifted()) {                                                                      // operand is  optionally shifted
-      SHIFT shiftOp = _flex.shift();
-      if (_flex.shiftedByReg()) {                                                               // shifted by register
-        REGISTER shift = std::get<REGISTER>(_flex.Rs());
-        instruction = (instruction << 4) | shift;
-        explanation.push_back({"Optional Shift Amount", "Shift by the value in " + regTitle[shift] + ".", 4});
-
-        instruction = (instruction << 2) | shiftOp;
-        explanation.push_back({"Optional Shift Operation", shiftTitle[shiftOp], 2});
-        instruction = (instruction << 1) | 1;
-        explanation.push_back({"Optional Shift Type", "The flexible operand is optionally shifted by a register value.", 1});
-      }
-      else if (_flex.shiftedByImm()) {                                                          // shifted by immediate
-        int shift = std::get<int>(_flex.Rs());
-        instruction = (instruction << 5) | shift;
-        explanation.push_back({"Optional Shift Amount", "Shift by the provided five bit immediate value (" + std::to_string(shift) + ").", 5});
-
-        instruction = ((instruction << 2) | shiftOp) << 1;
-        explanation.push_back({"Optional Shift Operation", shiftTitle[shiftOp], 2});
-        explanation.push_back({"Optional Shift Type", "The flexible operand is optionally shifted by an immediate value.", 1});
-      }
-      else throw AssemblyError("Optional shift operand Rs is neither a REGISTER nor IMMEDIATE value. Most likely a parser bug.", _statement);
-    }
-    else {                                                                                      // operand is not optionally shifted
-      instruction <<= 8;
-      explanation.push_back({"No Optional Shift", "The flexible operand is not optionally shifted.", 8});
-    }
-
-    REGISTER reg = std::get<REGISTER>(_flex.Rm());
-    instruction = (instruction << 4) | reg;
-    explanation.push_back({"Flexible Operand", regTitle[reg] + ". This operand has special properties in ARMv7. It can be either an immediate value or an optionally shifted register.", 4});
-  }
-  else throw AssemblyError("Source operand Rm is neither a REGISTER nor IMMEDIATE value. This is most likely a parser bug.", _statement);
+Encoding BiOperandNode::encode() const {
+  return encodeArithmetic(std::nullopt, _Rd, _flex);
+}
 
-  return {instruction, explanation};
+std::string BiOperandNode::explain(FIELD field) const {
+  if (field == FIRST_OPERAND) return std::string(regTitle[_Rd]) + ". The first operand is often referred to as the 'destination' register.";
+  if (field >= BARREL_SHIFT) return _flex.explain(field);
+  return InstructionNode::explain(field);
 }
 
 
@@ -279,99 +260,45 @@ std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> BiO
  * TriOperandNode
  * Responsible for parsing and delegating parsing of a binary operand instruction in ARMv7 assembly.
  */
-TriOperandNode::TriOperandNode(std::vector<lexer::Token> statement) : InstructionNode(statement) {
+TriOperandNode::TriOperandNode(std::vector<lexer::Token> statement) : InstructionNode(std::move(statement)) {
   auto [operation, modifier, condition] = splitOpCode(nextToken());
-  this->_op = opMap[operation];
+  this->_op = lookup::find(opMap, operation).value();
   this->_setFlags = modifier.empty() ? false : true;
-  this->_cond = condMap[condition];
+  this->_cond = lookup::find(condMap, condition).value();
 
   this->_Rd = parseRegister(nextToken());
   parseComma(nextToken());
   this->_Rn = parseRegister(nextToken());
 
   peekToken();                                                  // peek next token to see if it exists
-  this->_flex = FlexOperand(statement, currentToken);           // parsing delegated to FlexOperand
+  this->_flex = FlexOperand(std::move(_statement), currentToken);   // parsing delegated to FlexOperand, which borrows the tokens
+  this->_statement = _flex.release();
 }
 
 /**
- * Assembles this instruction into the proper machine code that would execute it on an ARM device.
+ * Encodes this instruction into the proper machine code that would execute it on an ARM device.
  */
-std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> TriOperandNode::assemble() {
-  uint32_t instruction = 0;
-  std::vector<std::tuple<std::string, std::string, int>> explanation;
-
-  instruction = (instruction << 4) | _cond;
-  explanation.push_back({"Condition Code", condTitle[_cond] + ". " + condExplain[_cond], 4});
-
-  instruction <<= 3;                // logical shift left 8 for data processing
-  explanation.push_back({"Instruction Type", "Arithmetic Operation. Indicates the organisation of bits to the processor so that the instruction can be decoded.", 3});
-
-  instruction = (instruction << 4) | _op;
-  explanation.push_back({"Operation Code", opTitle[_op] + ". " + opExplain[_op], 4});
-
-  instruction = (instruction << 1) | _setFlags;
-  explanation.push_back({"CPSR Flags", flagsExplain[_setFlags], 1});
-
-  instruction = (instruction << 4) | _Rn;
-  explanation.push_back({"Second Operand", regTitle[_Rn] + ". The second operand is often referred to as a 'source' register.", 4});
-
-  instruction = (instruction << 4) | _Rd;
-  explanation.push_back({"First Operand", regTitle[_Rd] + ". The first operand is often referred to as the 'destination' register.", 4});
-
-  if (_flex.isImm()) {                                                                          // operand is immediate
-    int imm = std::get<int>(_flex.Rm());
-    instruction = (instruction << 4) | _flex.immShift();
-    explanation.push_back({"Barrel Shifter", "The amount by which the eight bit immediate value is rotated right.", 4});
-    instruction = (instruction << 8) | imm;
-    explanation.push_back({"Immediate", "An eight bit immediate value. This value, along with the barrel shift, forms the second operand.", 8});
-  }
-  else if (_flex.isReg()) {                                                                     // operand is register
-    if (_flex.shifted()) {                                                                      // operand is  optionally shifted
-      SHIFT shiftOp = _flex.shift();
-      if (_flex.shiftedByReg()) {                                                               // shifted by register
-        REGISTER shift = std::get<REGISTER>(_flex.Rs());
-        instruction = (instruction << 4) | shift;
-        explanation.push_back({"Optional Shift Amount", "Shift by the value in " + regTitle[shift] + ".", 4});
-
-        instruction = (instruction << 2) | shiftOp;
-        explanation.push_back({"Optional Shift Operation", shiftTitle[shiftOp], 2});
-        instruction = (instruction << 1) | 1;
-        explanation.push_back({"Optional Shift Type", "The flexible operand is optionally shifted by a register value.", 1});
-      }
-      else if (_flex.shiftedByImm()) {                                                          // shifted by immediate
-        int shift = std::get<int>(_flex.Rs());
-        instruction = (instruction << 5) | shift;
-        explanation.push_back({"Optional Shift Amount", "Shift by the provided five bit immediate value (" + std::to_string(shift) + ").", 5});
-
-        instruction = ((instruction << 2) | shiftOp) << 1;
-        explanation.push_back({"Optional Shift Operation", shiftTitle[shiftOp], 2});
-        explanation.push_back({"Optional Shift Type", "The flexible operand is optionally shifted by an immediate value.", 1});
-      }
-      else throw AssemblyError("Optional shift operand Rs is neither a REGISTER nor IMMEDIATE value. Most likely a parser bug.", _statement);
-    }
-    else {                                                                                      // operand is not optionally shifted
-      instruction <<= 8;
-      explanation.push_back({"No Optional Shift", "The flexible operand is not optionally shifted.", 8});
-    }
-
-    REGISTER reg = std::get<REGISTER>(_flex.Rm());
-    instruction = (instruction << 4) | reg;
-    explanation.push_back({"Flexible Operand", regTitle[reg] + ". This operand has special properties in ARMv7. It can be either an immediate value or an optionally shifted register.", 4});
-  }
-  else throw AssemblyError("Source operand Rm is neither a REGISTER nor IMMEDIATE value. This is most likely a parser bug.", _statement);
+Encoding TriOperandNode::encode() const {
+  return encodeArithmetic(_Rn, _Rd, _flex);
+}
 
-  return {instruction, explanation};
+std::string TriOperandNode::explain(FIELD field) const {
+  if (field == SECOND_OPERAND) return std::string(regTitle[_Rn]) + ". The second operand is often referred to as a 'source' register.";
+  if (field == FIRST_OPERAND) return std::string(regTitle[_Rd]) + ". The first operand is often referred to as the 'destination' register.";
+  if (field >= BARREL_SHIFT) return _flex.explain(field);
+  return InstructionNode::explain(field);
 }
 
 /**
  * ShiftNode
  * Responsible for parsing shift operations, a special form of TriOperandNode.
  */
-ShiftNode::ShiftNode(std::vector<lexer::Token> statement) : InstructionNode(statement) {
+ShiftNode::ShiftNode(std::vector<lexer::Token> statement) : InstructionNode(std::move(statement)) {
   auto [operation, modifier, condition] = splitOpCode(nextToken());
-  this->_op = opMap[operation];
+  this->_op = MOV;                                              // shifts assemble to a MOV with a shifted operand
+  this->_shift = lookup::find(shiftMap, operation).value();
   this->_setFlags = modifier.empty() ? false : true;
-  this->_cond = condMap[condition];
+  this->_cond = lookup::find(condMap, condition).value();
 
   this->_Rd = parseRegister(nextToken());
   parseComma(nextToken());
@@ -383,23 +310,52 @@ ShiftNode::ShiftNode(std::vector<lexer::Token> statement) : InstructionNode(stat
 
 std::variant<std::monostate, REGISTER, int> ShiftNode::parseRegOrImm() {
   std::variant<std::monostate, REGISTER, int> flex;
-  try { flex = parseRegister(peekToken()); }                // attempt to parse as register by peeking at the next token
-  catch(SyntaxError e) {  }                                 // catch and carry on if syntax error
+  if (peekToken().type() == lexer::REGISTER) 
+    flex = parseRegister(peekToken());                      // parse as register by peeking at the next token
   
-  if (flex.index() == 0) {
-    try { flex = parseImmediate(peekToken(), 5); }          // attempt to parse as immediate by peeking at the next token
+  else if (isImmediate(peekToken())) {
+    try { flex = int(parseImmediate(peekToken(), 5)); }     // attempt to parse as immediate by peeking at the next token
     catch(SyntaxError e) {  }                               // catch and carry on if syntax error (fail on numerical error)
   }
 
   if (flex.index() == 0)
-    throw SyntaxError("Expected either REGISTER or IMMEDIATE value - received " + lexer::tokenNames[peekToken().type()] + " '" + peekToken().value() + "' instead.", _statement, currentToken); 
+    throw SyntaxError("Expected either REGISTER or IMMEDIATE value - received " + std::string(lexer::tokenNames[peekToken().type()]) + " '" + std::string(peekToken().value()) + "' instead.", _statement, currentToken); 
   
   nextToken();                                              // advance token because currently only peeked
   return flex;
 }
 
-std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> ShiftNode::assemble() {
-  return {0, {{"", "", 0}}};
+/**
+ * Encodes a shift as the MOV with a shifted register operand which it is executed as.
+ */
+Encoding ShiftNode::encode() const {
+  Encoding encoding;
+  for (FIELD field : {CONDITION_CODE, INSTRUCTION_TYPE, OPERATION_CODE, CPSR_FLAGS, SECOND_UNUSED, FIRST_OPERAND}) encoding.add(field);
+
+  uint32_t operand2;
+  if (_Rs.index() == 1) {                                                                       // shifted by register
+    for (FIELD field : {SHIFT_REGISTER, SHIFT_OPERATION, SHIFT_BY_REGISTER}) encoding.add(field);
+    operand2 = encodeShiftByRegister(_Rn, _shift, std::get<REGISTER>(_Rs));
+  }
+  else {                                                                                        // shifted by immediate
+    for (FIELD field : {SHIFT_AMOUNT, SHIFT_OPERATION, SHIFT_BY_IMMEDIATE}) encoding.add(field);
+    operand2 = encodeShiftByImmediate(_Rn, _shift, std::get<int>(_Rs));
+  }
+  encoding.add(FLEXIBLE_OPERAND);
+
+  encoding.word = syntax::encodeDataProcessing(_cond, MOV, _setFlags, R0, _Rd, operand2);
+  return encoding;
+}
+
+std::string ShiftNode::explain(FIELD field) const {
+  switch (field) {
+    case FIRST_OPERAND: return std::string(regTitle[_Rd]) + ". The first operand is often referred to as the 'destination' register.";
+    case SHIFT_REGISTER: return "Shift by the value in " + std::string(regTitle[std::get<REGISTER>(_Rs)]) + ".";
+    case SHIFT_OPERATION: return shiftTitle[_shift];
+    case SHIFT_AMOUNT: return "Shift by the provided five bit immediate value (" + std::to_string(std::get<int>(_Rs)) + ").";
+    case FLEXIBLE_OPERAND: return std::string(regTitle[_Rn]) + ". The register which is shifted and moved into the first operand.";
+    default: return InstructionNode::explain(field);
+  }
 }
 
 
@@ -409,18 +365,61 @@ std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> Shi
  */
 FlexOperand::FlexOperand() = default;
 
-FlexOperand::FlexOperand(std::vector<lexer::Token> statement, unsigned int currentToken) : Node(statement, currentToken) {
+FlexOperand::FlexOperand(std::vector<lexer::Token> statement, unsigned int currentToken) : Node(std::move(statement), currentToken) {
   parseComma(nextToken());
   this->_Rm = parseRegOrImm();      // parse immediate with default 8 bits (with extended 4 bit shift)
   if (_Rm.index() == 1 && hasToken()) parseShift();
 
-  if (hasToken()) throw SyntaxError("Unexpected token '" + peekToken().value() + "' after valid instruction end.", statement, peekToken().tokenNumber());
+  if (hasToken()) throw SyntaxError("Unexpected token '" + std::string(peekToken().value()) + "' after valid instruction end.", _statement, peekToken().tokenNumber());
 };
 
+/**
+ * Encodes the twelve bit second operand, adding the fields it is made of to the instruction encoding.
+ */
+uint32_t FlexOperand::encode(Encoding& encoding) const {
+  if (isImm()) {                                                                                // operand is immediate
+    encoding.add(BARREL_SHIFT);
+    encoding.add(IMMEDIATE_VALUE);
+    return encodeImmediate(_immShift / 2, std::get<int>(_Rm));             // the field holds half the rotation
+  }
+  if (!isReg()) throw AssemblyError("Source operand Rm is neither a REGISTER nor IMMEDIATE value. This is most likely a parser bug.", _statement);
+
+  REGISTER Rm = std::get<REGISTER>(_Rm);
+  uint32_t operand2;
+  if (shiftedByReg()) {                                                                         // shifted by register
+    for (FIELD field : {SHIFT_REGISTER, SHIFT_OPERATION, SHIFT_BY_REGISTER}) encoding.add(field);
+    operand2 = encodeShiftByRegister(Rm, _shift, std::get<REGISTER>(_Rs));
+  }
+  else if (shiftedByImm()) {                                                                    // shifted by immediate
+    for (FIELD field : {SHIFT_AMOUNT, SHIFT_OPERATION, SHIFT_BY_IMMEDIATE}) encoding.add(field);
+    operand2 = encodeShiftByImmediate(Rm, _shift, std::get<int>(_Rs));
+  }
+  else {                                                                                        // operand is not optionally shifted
+    encoding.add(NO_SHIFT);
+    operand2 = encodeRegister(Rm);
+  }
+
+  encoding.add(FLEXIBLE_OPERAND);
+  return operand2;
+}
+
+/**
+ * Describes the fields of the second operand which depend on its values.
+ */
+std::string FlexOperand::explain(FIELD field) const {
+  switch (field) {
+    case SHIFT_REGISTER: return "Shift by the value in " + std::string(regTitle[std::get<REGISTER>(_Rs)]) + ".";
+    case SHIFT_OPERATION: return shiftTitle[_shift];
+    case SHIFT_AMOUNT: return "Shift by the provided five bit immediate value (" + std::to_string(std::get<int>(_Rs)) + ").";
+    case FLEXIBLE_OPERAND: return std::string(regTitle[std::get<REGISTER>(_Rm)]) + ". This operand has special properties in ARMv7. It can be either an immediate value or an optionally shifted register.";
+    default: return fieldInfo[field].detail ? fieldInfo[field].detail : "";
+  }
+}
+
 void FlexOperand::parseShift() {
   parseComma(nextToken());
   if (peekToken().type()== lexer::SHIFT)
-    this->_shift = shiftMap[nextToken().value()];
+    this->_shift = lookup::find(shiftMap, nextToken().value()).value();
   else throw SyntaxError("The comma after the final operand indicates an optional shift, but no shift was found.", _statement, currentToken);
 
   this->_Rs = parseRegOrImm(5);     // parse immediate with a max length of 5 bits
@@ -428,23 +427,19 @@ void FlexOperand::parseShift() {
 
 std::variant<std::monostate, REGISTER, int> FlexOperand::parseRegOrImm(unsigned int immBits) {
   std::variant<std::monostate, REGISTER, int> flex;
-  try { flex = parseRegister(peekToken()); }                      // attempt to parse as register by peeking at the next token
-  catch(SyntaxError e) {  }                                       // catch and carry on if syntax error
+  if (peekToken().type() == lexer::REGISTER)
+    flex = parseRegister(peekToken());                            // parse as register by peeking at the next token
   
-  if (flex.index() == 0) {
+  else if (isImmediate(peekToken())) {
     try { 
-      unsigned int immShift = 0;
-      if (immBits == 8) {
-        flex = parseImmediate(peekToken(), immBits, immShift);    // attempt to parse as immediate by peeking at the next token
-        this->_immShift = immShift;
-      }
-      else flex = parseImmediate(peekToken(), immBits);
+      if (immBits == 8) flex = int(parseModifiedImmediate(peekToken(), _immShift));   // attempt to parse as immediate by peeking at the next token
+      else flex = int(parseImmediate(peekToken(), immBits));
     }                                                           
     catch(SyntaxError e) {  }                                     // catch and carry on if syntax error (fail on numerical error)
   }
 
   if (flex.index() == 0)
-    throw SyntaxError("Expected either REGISTER or IMMEDIATE value - received " + lexer::tokenNames[peekToken().type()] + " '" + peekToken().value() + "' instead.", _statement, currentToken); 
+    throw SyntaxError("Expected either REGISTER or IMMEDIATE value - received " + std::string(lexer::tokenNames[peekToken().type()]) + " '" + std::string(peekToken().value()) + "' instead.", _statement, currentToken); 
   
   nextToken();                                                    // advance token because currently only peeked
   return flex;
@@ -454,21 +449,22 @@ std::variant<std::monostate, REGISTER, int> FlexOperand::parseRegOrImm(unsigned
 /**
  * Node which holds a section change declaration
  */
-DirectiveNode::DirectiveNode(std::vector<lexer::Token> statement) : Node(statement) {
-  if (directiveMap.contains(peekToken().value())) {
-    this->directive = directiveMap.at(nextToken().value());
+DirectiveNode::DirectiveNode(std::vector<lexer::Token> statement) : Node(std::move(statement)) {
+  if (auto found = lookup::find(directiveMap, peekToken().value())) {
+    this->directive = *found;
+    nextToken();
   }
-  else throw SyntaxError("Unrecognised directive '" + peekToken().value() + "'.", statement, peekToken().tokenNumber());
+  else throw SyntaxError("Unrecognised directive '" + std::string(peekToken().value()) + "'.", _statement, peekToken().tokenNumber());
   
-  if (hasToken()) throw SyntaxError("Unexpected token '" + peekToken().value() + "' after valid section declaration end.", statement, peekToken().tokenNumber());
+  if (hasToken()) throw SyntaxError("Unexpected token '" + std::string(peekToken().value()) + "' after valid section declaration end.", _statement, peekToken().tokenNumber());
 }
 
 
-AllocationNode::AllocationNode(std::vector<lexer::Token> statement) : Node(statement) {
-  this->_identifier = peekToken().value().substr(0, nextToken().value().size() - 1);
+AllocationNode::AllocationNode(std::vector<lexer::Token> statement) : Node(std::move(statement)) {
+  this->_identifier = nextToken().symbol();
 
   lexer::Token typeDirective = nextToken();
-  int type = syntax::typeMap.at(typeDirective.value()).index();
+  int type = lookup::find(syntax::typeMap, typeDirective.value()).value();
   if (type == 0) {         // .skip
     this->_value.emplace<size_t>(parseImmediate(makeImmediate(nextToken()), 32));
   }
@@ -483,13 +479,13 @@ AllocationNode::AllocationNode(std::vector<lexer::Token> statement) : Node(state
   }
   else if (type == 4) {    // .asciz, .ascii, .string
     if (peekToken().type() != lexer::STRING) 
-      throw SyntaxError("Expected STRING value for type directive '" + typeDirective.value() + "' - received " + lexer::tokenNames[peekToken().type()] + " '" + peekToken().value() + "' instead.", statement, currentToken); 
+      throw SyntaxError("Expected STRING value for type directive '" + std::string(typeDirective.value()) + "' - received " + std::string(lexer::tokenNames[peekToken().type()]) + " '" + std::string(peekToken().value()) + "' instead.", _statement, currentToken); 
 
-    std::string str = nextToken().value();
+    std::string str(nextToken().value());
     this->_value.emplace<std::string>(str.substr(str.find_first_of("\"") + 1, str.find_last_of("\"") - 1));
   }
 
-  if (hasToken()) throw SyntaxError("Unexpected token '" + peekToken().value() + "' after valid data declaration end.", statement, peekToken().tokenNumber());
+  if (hasToken()) throw SyntaxError("Unexpected token '" + std::string(peekToken().value()) + "' after valid data declaration end.", _statement, peekToken().tokenNumber());
 }
 
 lexer::Token AllocationNode::makeImmediate(lexer::Token token) {
@@ -524,8 +520,8 @@ std::string AllocationNode::printValue() const {
 /**
  * Node which holds a label indicating a named point in the program which can be branched to
  */
-LabelNode::LabelNode(std::vector<lexer::Token> statement) : Node(statement) {
-  this->_identifier = peekToken().value().substr(0, nextToken().value().size() - 1);
+LabelNode::LabelNode(std::vector<lexer::Token> statement) : Node(std::move(statement)) {
+  this->_identifier = nextToken().symbol();
 
-  if (hasToken()) throw SyntaxError("Unexpected token '" + peekToken().value() + "' after valid data declaration end.", statement, peekToken().tokenNumber());
+  if (hasToken()) throw SyntaxError("Unexpected token '" + std::string(peekToken().value()) + "' after valid data declaration end.", _statement, peekToken().tokenNumber());
 }
\ No newline at end of file
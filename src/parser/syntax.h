@@ -12,19 +12,35 @@
 #include "../lexer/lexer.h"
 #include "constants.h"
 #include <vector>
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <map>
+#include <optional>
+#include <typeinfo>
 #include <variant>
+#include <type_traits>
+#include <utility>
 
 namespace syntax {
 
+  class FlexOperand;
+
   class Node {
     public:
       Node();
       Node(std::vector<lexer::Token>);
       Node(std::vector<lexer::Token>, unsigned int);
-      std::vector<lexer::Token> statement() const { return _statement; };
+      Node(const Node&) = default;
+      Node(Node&&) = default;
+      Node& operator=(const Node&) = default;
+      Node& operator=(Node&&) = default;
+      const std::vector<lexer::Token>& statement() const { return _statement; };
+      std::vector<lexer::Token> release() { return std::move(_statement); };   // hands the tokens back for reuse
       // FAMILY family() const { return _family; };
-      std::string toString();
+      std::string toString() const;
+      virtual Node* clone() const { return new Node(*this); };
+      void relocate(unsigned int);
       virtual ~Node();
 
     protected:
@@ -36,17 +52,89 @@ namespace syntax {
       bool hasToken();
       bool parseComma(lexer::Token);
       REGISTER parseRegister(lexer::Token);
+      bool isImmediate(lexer::Token);
       uint32_t parseImmediate(lexer::Token, unsigned int);
-      uint32_t parseImmediate(lexer::Token, unsigned int, unsigned int&);
+      uint32_t parseModifiedImmediate(lexer::Token, unsigned int&);
 
     private:
       uint64_t parseImmediate(lexer::Token);
   };
 
+  // The machine code of an instruction and the fields it is explained in, most significant first
+  struct Encoding {
+    uint32_t word = 0;
+    std::array<FIELD, 12> fields {};
+    uint8_t count = 0;
+
+    constexpr void add(FIELD field) { fields[count++] = field; };
+  };
+
+  // Bit layouts of a data processing instruction and of its flexible second operand
+  constexpr uint32_t encodeDataProcessing(CONDITION cond, OPERATION op, bool setFlags, unsigned int Rn, unsigned int Rd, uint32_t operand2) {
+    return (uint32_t(cond) << 28) | (uint32_t(op) << 21) | (uint32_t(setFlags) << 20) | (Rn << 16) | (Rd << 12) | operand2;
+  }
+
+  constexpr uint32_t encodeImmediate(unsigned int rotate, uint32_t imm) {
+    return (1 << 25) | (rotate << 8) | imm;                 // bit 25 marks the second operand as immediate
+  }
+
+  // An immediate operand as the processor holds it: eight bits rotated right by twice a four bit amount
+  struct ModifiedImmediate {
+    uint32_t imm;
+    unsigned int rotate;
+  };
+
+  /**
+   * Finds the encoding of a 32-bit constant as a modified immediate, or nothing if it has none. Every one of the
+   * sixteen rotations is tested at once by collecting a bit per rotation which undoes the constant into eight bits,
+   * and the smallest rotation is taken, as assemblers do.
+   */
+  constexpr std::optional<ModifiedImmediate> encodeModifiedImmediate(uint32_t value) {
+    unsigned int valid = 0;
+    for (unsigned int rotate = 0; rotate < 16; rotate++) valid |= unsigned(std::rotl(value, 2 * rotate) <= 0xff) << rotate;
+    if (valid == 0) return std::nullopt;
+
+    unsigned int rotate = std::countr_zero(valid);
+    return ModifiedImmediate{std::rotl(value, 2 * rotate), rotate};
+  }
+
+  constexpr uint32_t encodeRegister(unsigned int Rm) {
+    return Rm;
+  }
+
+  constexpr uint32_t encodeShiftByRegister(unsigned int Rm, SHIFT shift, unsigned int Rs) {
+    return (Rs << 8) | (uint32_t(shift) << 5) | (1 << 4) | Rm;
+  }
+
+  constexpr uint32_t encodeShiftByImmediate(unsigned int Rm, SHIFT shift, unsigned int amount) {
+    return (amount << 7) | (uint32_t(shift) << 5) | Rm;
+  }
+
+  // Bit layouts of a branch to an offset in instructions from the PC, and of a branch to the address in a register
+  constexpr uint32_t encodeBranch(CONDITION cond, bool link, int32_t offset) {
+    return (uint32_t(cond) << 28) | (0b101 << 25) | (uint32_t(link) << 24) | (uint32_t(offset) & 0xffffff);
+  }
+
+  constexpr uint32_t encodeBranchExchange(CONDITION cond, bool link, unsigned int Rm) {
+    return (uint32_t(cond) << 28) | 0x012fff10 | (uint32_t(link) << 5) | Rm;
+  }
+
+  static_assert(encodeDataProcessing(AL, MOV, false, 0, R1, encodeImmediate(0, 5)) == 0xe3a01005);
+  static_assert(encodeDataProcessing(AL, MOV, false, 0, R1, encodeImmediate(15, 0xff)) == 0xe3a01fff);
+  static_assert(encodeDataProcessing(AL, ADD, true, R2, R3, encodeShiftByImmediate(R4, LSL, 2)) == 0xe0923104);
+  static_assert(encodeModifiedImmediate(0xff)->rotate == 0 && encodeModifiedImmediate(0x3fc)->rotate == 15);
+  static_assert(encodeModifiedImmediate(0xf000000f)->imm == 0xff && encodeModifiedImmediate(0xf000000f)->rotate == 2);
+  static_assert(!encodeModifiedImmediate(0x101) && !encodeModifiedImmediate(0x1fe00000 | 1));
+  static_assert(encodeDataProcessing(AL, MOV, true, 0, R0, encodeShiftByRegister(R1, ASR, R2)) == 0xe1b00251);
+  static_assert(encodeBranch(AL, true, -2) == 0xebfffffe && encodeBranch(NE, false, 3) == 0x1a000003);
+  static_assert(encodeBranchExchange(AL, false, LR) == 0xe12fff1e && encodeBranchExchange(AL, true, R3) == 0xe12fff33);
+
   class InstructionNode : public Node {
     public:
       InstructionNode(std::vector<lexer::Token>);
-      virtual std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> assemble() = 0;
+      virtual Encoding encode() const = 0;
+      virtual std::string explain(FIELD) const;
+      const Encoding& encoding();
       OPERATION op() const { return _op; };
       CONDITION cond() const { return _cond; };
       bool setFlags() const { return _setFlags; };
@@ -55,19 +143,33 @@ namespace syntax {
       OPERATION _op;
       CONDITION _cond;
       bool _setFlags;
+      std::optional<Encoding> _encoding;      // assembled on first use, since instructions are often executed many times
 
-      std::tuple<std::string, std::string, std::string> splitOpCode(lexer::Token);
+      Encoding encodeArithmetic(std::optional<REGISTER>, REGISTER, const FlexOperand&) const;
+
+      std::tuple<std::string_view, std::string_view, std::string_view> splitOpCode(lexer::Token);
   };
 
   class BranchNode : public InstructionNode {
     public:
       BranchNode(std::vector<lexer::Token>);
-      std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> assemble() override;
-      std::tuple<OPERATION, CONDITION, std::variant<REGISTER, std::string>> unpack() const { return {_op, _cond, _Rd}; };
+      BranchNode* clone() const override { return new BranchNode(*this); };
+      Encoding encode() const override;
+      std::string explain(FIELD) const override;
+      std::tuple<OPERATION, CONDITION, std::variant<REGISTER, lexer::Symbol>> unpack() const { return {_op, _cond, _Rd}; };
+      bool toLabel() const { return _Rd.index() == 1; };
+      lexer::Symbol label() const { return std::get<lexer::Symbol>(_Rd); };
+      uint32_t address() const { return _address; };
+      void link(uint32_t address) { _address = address; _encoding.reset(); };
+      void place(uint32_t address) { _from = address; _encoding.reset(); };
 
     protected:
-      std::variant<REGISTER, std::string> _Rd;
-      uint32_t _offset;
+      std::variant<REGISTER, lexer::Symbol> _Rd;
+      uint32_t _address = 0;                  // resolved address of the label operand, filled in by the assembler
+      uint32_t _from = 0;                     // address of the branch itself, filled in when its program is loaded
+
+    private:
+      int32_t offset() const { return (int64_t(_address) - _from) / 32 - 2; };     // the PC reads two instructions ahead
   };
 
   class FlexOperand : public Node {
@@ -89,6 +191,8 @@ namespace syntax {
       bool shifted() const { return _Rs.index() > 0; };
       bool shiftedByReg() const { return _Rs.index() == 1; };
       bool shiftedByImm() const { return _Rs.index() == 2; };
+      uint32_t encode(Encoding&) const;
+      std::string explain(FIELD) const;
 
     protected:
       std::variant<std::monostate, REGISTER, int> _Rm;
@@ -104,10 +208,12 @@ namespace syntax {
   class BiOperandNode : public InstructionNode {
     public:
       BiOperandNode(std::vector<lexer::Token>);
-      std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> assemble() override;
+      BiOperandNode* clone() const override { return new BiOperandNode(*this); };
+      Encoding encode() const override;
+      std::string explain(FIELD) const override;
       REGISTER Rd() const { return _Rd; };
-      FlexOperand flex() const { return _flex; };
-      std::tuple<OPERATION, CONDITION, bool, REGISTER, FlexOperand> unpack() const { return {_op, _cond, _setFlags, _Rd, _flex}; };
+      const FlexOperand& flex() const { return _flex; };
+      std::tuple<OPERATION, CONDITION, bool, REGISTER, const FlexOperand&> unpack() const { return {_op, _cond, _setFlags, _Rd, _flex}; };
 
     protected:
       REGISTER _Rd;
@@ -117,11 +223,13 @@ namespace syntax {
   class TriOperandNode : public InstructionNode {
     public:
       TriOperandNode(std::vector<lexer::Token>);
-      std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> assemble() override;
+      TriOperandNode* clone() const override { return new TriOperandNode(*this); };
+      Encoding encode() const override;
+      std::string explain(FIELD) const override;
       REGISTER Rd() const { return _Rd; };
       REGISTER Rn() const { return _Rn; };
-      FlexOperand flex() const { return _flex; };
-      std::tuple<OPERATION, CONDITION, bool, REGISTER, REGISTER, FlexOperand> unpack() const { return {_op, _cond, _setFlags, _Rd, _Rn, _flex}; };
+      const FlexOperand& flex() const { return _flex; };
+      std::tuple<OPERATION, CONDITION, bool, REGISTER, REGISTER, const FlexOperand&> unpack() const { return {_op, _cond, _setFlags, _Rd, _Rn, _flex}; };
 
     protected:
       REGISTER _Rd;
@@ -132,13 +240,17 @@ namespace syntax {
   class ShiftNode : public InstructionNode {
     public:
       ShiftNode(std::vector<lexer::Token>);
-      std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> assemble() override;
+      ShiftNode* clone() const override { return new ShiftNode(*this); };
+      Encoding encode() const override;
+      std::string explain(FIELD) const override;
       REGISTER Rd() const { return _Rd; };
       REGISTER Rn() const { return _Rn; };
       std::variant<std::monostate, REGISTER, int> Rs() const { return _Rs; };
-      std::tuple<OPERATION, CONDITION, bool, REGISTER, REGISTER, std::variant<std::monostate, REGISTER, int>> unpack() const { return {_op, _cond, _setFlags, _Rd, _Rn, _Rs}; };
+      SHIFT shift() const { return _shift; };
+      std::tuple<SHIFT, CONDITION, bool, REGISTER, REGISTER, std::variant<std::monostate, REGISTER, int>> unpack() const { return {_shift, _cond, _setFlags, _Rd, _Rn, _Rs}; };
 
     protected:
+      SHIFT _shift;
       REGISTER _Rd;
       REGISTER _Rn;
       std::variant<std::monostate, REGISTER, int> _Rs;
@@ -151,7 +263,9 @@ namespace syntax {
   class LoadStoreNode : public InstructionNode {
     public:
       LoadStoreNode(std::vector<lexer::Token>);
-      std::tuple<uint32_t, std::vector<std::tuple<std::string, std::string, int>>> assemble() override;
+      Encoding encode() const override;
+      REGISTER Rd() const { return _Rd; };
+      REGISTER Rn() const { return _Rn; };
       
     protected:
       SIZE _size;
@@ -167,6 +281,7 @@ namespace syntax {
   class DirectiveNode : public Node {
     public:
       DirectiveNode(std::vector<lexer::Token>);
+      DirectiveNode* clone() const override { return new DirectiveNode(*this); };
       DIRECTIVE directive;
       bool isText() const { return directive == TEXT; };
       bool isData() const { return directive == DATA; };  
@@ -177,12 +292,13 @@ namespace syntax {
   class AllocationNode : public Node {
     public:
       AllocationNode(std::vector<lexer::Token>);
-      std::string identifier() const { return _identifier; };
+      AllocationNode* clone() const override { return new AllocationNode(*this); };
+      lexer::Symbol identifier() const { return _identifier; };
       std::variant<size_t, uint8_t, uint16_t, uint32_t, std::string> value() const { return _value; };
       std::string printValue() const;
       
     protected:
-      std::string _identifier;
+      lexer::Symbol _identifier;
       std::variant<size_t, uint8_t, uint16_t, uint32_t, std::string> _value;
       lexer::Token makeImmediate(lexer::Token);
   };
@@ -191,11 +307,47 @@ namespace syntax {
   class LabelNode : public Node {
     public:
       LabelNode(std::vector<lexer::Token>);
-      std::string identifier() const { return _identifier; };
+      LabelNode* clone() const override { return new LabelNode(*this); };
+      lexer::Symbol identifier() const { return _identifier; };
       
     protected:
-      std::string _identifier;
+      lexer::Symbol _identifier;
   };
+
+  // A parsed statement held by value, so that statements which are executed once and thrown away never touch the heap
+  using Statement = std::variant<std::monostate, BranchNode, BiOperandNode, TriOperandNode, ShiftNode, DirectiveNode, AllocationNode, LabelNode>;
+
+  inline Node* node(Statement& statement) {
+    return std::visit([](auto& node) -> Node* { 
+      if constexpr (std::is_same_v<std::decay_t<decltype(node)>, std::monostate>) return nullptr;
+      else return &node;
+    }, statement);
+  }
+
+  /**
+   * The index of the Statement alternative which holds nodes of the same type as the given one, or 0 if none does.
+   */
+  inline size_t kind(const Node& node) {
+    return [&]<size_t... I>(std::index_sequence<I...>) {
+      size_t index = 0;
+      ((typeid(node) == typeid(std::variant_alternative_t<I, Statement>) && (index = I)) || ...);
+      return index;
+    }(std::make_index_sequence<std::variant_size_v<Statement>>());
+  }
+
+  /**
+   * Copies a node into a statement. When the statement already holds a node of the same type it is assigned 
+   * over, which reuses the storage of its tokens instead of allocating fresh ones.
+   */
+  template <typename... T>
+  void assign(std::variant<std::monostate, T...>& statement, const Node& node) {
+    ([&]{
+      if (typeid(node) != typeid(T)) return false;
+      if (T* held = std::get_if<T>(&statement)) *held = static_cast<const T&>(node);
+      else statement.template emplace<T>(static_cast<const T&>(node));
+      return true;
+    }() || ...);
+  }
 }
 
 #endif //IRISC_SYNTAX_H
@@ -9,38 +9,44 @@
 #define IRISC_UI_CONSTANTS_H
 
 #include <map>
-#include <vector>
+#include <string_view>
 #include <FL/Fl_Text_Display.H>
 #include <FL/Fl.H>
-#include "replxx.hxx"
 
 namespace ui {
-  static std::vector<std::string> directives {
+  inline constexpr std::string_view directives[] = {
     ".text", ".data", ".global", ".asciz", ".word", ".skip"
   };
-
-  using cl = replxx::Replxx::Color;
-  static std::vector<std::pair<std::string, cl>> regex_color {
-    {"#((0x([0-9]|[a-f])+)|(0b([0-1]+))|((0d)?[0-9]+))", cl::GRAY},
-    {"\\.[A-Za-z]+", cl::BRIGHTMAGENTA}
-  };
   
   static Fl_Color dark = fl_rgb_color(uchar(35));
   static Fl_Color grey = fl_rgb_color(uchar(175));
   static Fl_Color light = fl_rgb_color(uchar(225));
   static Fl_Color red = fl_rgb_color(uchar(255), uchar(85), uchar(85));
   static Fl_Color blue = fl_rgb_color(uchar(85), uchar(85), uchar(255));
+  static Fl_Color heat[] = {                // profiled lines, from least to most often run
+    fl_rgb_color(uchar(120), uchar(150), uchar(200)),
+    fl_rgb_color(uchar(150), uchar(200), uchar(150)),
+    fl_rgb_color(uchar(230), uchar(220), uchar(100)),
+    fl_rgb_color(uchar(255), uchar(160), uchar(60)),
+    fl_rgb_color(uchar(255), uchar(70), uchar(50))
+  };
 
   // Style table
   static Fl_Text_Display::Style_Table_Entry styles[] = {
-  //  FONT COLOR        FONT FACE     FONT SIZE
-  //  ----------------- ------------- --------------
-    { FL_WHITE,         FL_COURIER,   20 },   // A - default
-    { red,              FL_COURIER,   20 },   // B - Red
-    { blue,             FL_COURIER,   20 },   // C - Blue
-    { FL_MAGENTA,       FL_COURIER,   20 },   // D - Magenta
-    { FL_DARK_YELLOW,   FL_COURIER,   20 },   // E - Yellow
-    { FL_DARK_GREEN,    FL_COURIER,   20 },   // F - Green
+  //  FONT COLOR        FONT FACE           FONT SIZE
+  //  ----------------- ------------------- --------------
+    { FL_WHITE,         FL_COURIER,         20 },   // A - default
+    { red,              FL_COURIER,         20 },   // B - Red
+    { blue,             FL_COURIER,         20 },   // C - Blue
+    { FL_MAGENTA,       FL_COURIER,         20 },   // D - Magenta
+    { FL_DARK_YELLOW,   FL_COURIER,         20 },   // E - Yellow
+    { FL_DARK_GREEN,    FL_COURIER,         20 },   // F - Green
+    { red,              FL_COURIER_ITALIC,  20 },   // G - Error
+    { heat[0],          FL_COURIER,         20 },   // H - Heat, coldest
+    { heat[1],          FL_COURIER,         20 },   // I - Heat
+    { heat[2],          FL_COURIER,         20 },   // J - Heat
+    { heat[3],          FL_COURIER,         20 },   // K - Heat
+    { heat[4],          FL_COURIER_BOLD,    20 },   // L - Heat, hottest
   };
 
   // static std::map<std::string, char> styleMap = {
@@ -0,0 +1,29 @@
+#include "dictionary.h"
+#include <algorithm>
+#include <mutex>
+
+using namespace ui;
+
+/**
+ * Replaces every word in the set.
+ */
+void Dictionary::assign(std::vector<std::string> replacement) {
+  std::sort(replacement.begin(), replacement.end());
+  replacement.erase(std::unique(replacement.begin(), replacement.end()), replacement.end());
+
+  std::unique_lock lock(mutex);
+  words = std::move(replacement);
+}
+
+/**
+ * Returns up to limit words which begin with the given prefix, in alphabetical order.
+ */
+std::vector<std::string> Dictionary::complete(std::string_view prefix, size_t limit) const {
+  std::shared_lock lock(mutex);
+  std::vector<std::string> matches;
+
+  auto it = std::lower_bound(words.begin(), words.end(), prefix, [](const std::string& word, std::string_view prefix){ return word < prefix; });
+  for (; it != words.end() && it->starts_with(prefix) && matches.size() < limit; ++it) matches.push_back(*it);
+
+  return matches;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file dictionary.h
+ * A sorted set of words for REPL completion and hints. Completions for a prefix are found with a binary
+ * search for the range of words which begin with it, so lookups stay fast as the set grows. The words can
+ * be replaced from other threads, e.g. by the emulator whenever a program is assembled.
+ * @date 18/10/26
+ */
+
+#ifndef IRISC_DICTIONARY_H
+#define IRISC_DICTIONARY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <shared_mutex>
+
+namespace ui {
+  class Dictionary {
+    private:
+      std::vector<std::string> words;                 // sorted and without duplicates
+      mutable std::shared_mutex mutex;
+
+    public:
+      Dictionary() = default;
+      void assign(std::vector<std::string>);
+      std::vector<std::string> complete(std::string_view, size_t limit = 128) const;
+  };
+}
+
+#endif //IRISC_DICTIONARY_H
@@ -1,7 +1,10 @@
 #include "editor.h"
 #include "constants.h"
 #include "../parser/constants.h"
-#include <regex>
+#include "../parser/parser.h"
+#include "../error.h"
+#include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <string>
 #include <FL/Fl.H>
@@ -12,11 +15,11 @@
 
 using namespace ui;
 
-void changed_cb(int, int nInserted, int nDeleted,int, const char*, void* v) {
+void changed_cb(int pos, int nInserted, int nDeleted, int, const char* deletedText, void* v) {
   if (nInserted || nDeleted) {
     Editor *editor = (Editor *)v;
     editor->editor->show_insert_position();
-    editor->highlight();
+    editor->reparse(pos, nInserted, nDeleted, deletedText);
   }
 }
 
@@ -36,7 +39,7 @@ void cursorBlink(void* window) {
   Fl::repeat_timeout(0.5, cursorBlink, window);
 }
 
-Editor::Editor(vm::Emulator& emulator) : cursorHidden(false), emulator(emulator) {
+Editor::Editor(vm::Emulator& emulator) : cursorHidden(false), emulator(emulator), lines(1) {
   emulator.setEditor(this);           // link editor and emulator
 
   Fl::lock();
@@ -90,8 +93,11 @@ Editor::Editor(vm::Emulator& emulator) : cursorHidden(false), emulator(emulator)
     run->callback(run_cb, this);
     stp->callback(stop_cb, this);
 
-    Fl_Box* space = new Fl_Box(10, 10, 170, 25);
-    btns->resizable(space);
+    status = new Fl_Box(10, 10, 170, 25);
+    status->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE | FL_ALIGN_CLIP);
+    status->labelcolor(ui::red);
+    status->labelsize(12);
+    btns->resizable(status);
     btns->end();
 
     window->end();
@@ -99,54 +105,173 @@ Editor::Editor(vm::Emulator& emulator) : cursorHidden(false), emulator(emulator)
   Fl::unlock();
 
   Fl::awake();
-  fetchStyles();
 };
 
-void Editor::fetchStyles() {
-	for (auto const& [op, i] : syntax::opMap) {
-		for (auto flag : {"", "s"}) {
-			for (auto const& [cond, i] : syntax::condMap) {
-				styleMap.insert({op + flag + cond, 'B'});
-			}
-		}
-	}
-
-	for (auto const& [reg, i] : syntax::regMap) {
-		styleMap.insert({reg, 'C'});
-	}
-
-  for (auto const& directive : directives) {
-    styleMap.insert({directive, 'D'});
+/**
+ * The style character used to highlight each type of token.
+ */
+static char styleOf(lexer::TOKEN type) {
+  switch (type) {
+    case lexer::BRANCH:
+    case lexer::BI_OPERAND:
+    case lexer::TRI_OPERAND:
+    case lexer::LOAD_STORE:
+    case lexer::SHIFT:
+      return 'B';
+    case lexer::REGISTER:
+      return 'C';
+    case lexer::DIRECTIVE:
+      return 'D';
+    default:
+      return 'A';
   }
-};
+}
 
-void Editor::highlight() {
-  std::string input = textbuf->text();
-  std::regex re("[, \\n\\t]+");
-  
-  std::sregex_token_iterator it(input.begin(), input.end(), re, -1);
-  std::sregex_token_iterator end;
+/**
+ * Brings the line cache up to date after an edit. Only the lines touched by the edit are lexed and parsed
+ * again; every other line keeps its tokens and syntax node.
+ */
+void Editor::reparse(int pos, int nInserted, int nDeleted, const char* deletedText) {
+  int first = textbuf->count_lines(0, pos);                                 // the line on which the edit starts
+  int removed = nDeleted ? std::count(deletedText, deletedText + nDeleted, '\n') : 0;
+  char* inserted = textbuf->text_range(pos, pos + nInserted);
+  int added = std::count(inserted, inserted + nInserted, '\n');
+  free(inserted);
+
+  // the extent of the replaced lines in the style buffer, which still mirrors the text before the edit
+  int start = textbuf->line_start(pos);
+  int end = start + removed;
+  int last = std::min<size_t>(first + removed + 1, lines.size());
+  for (int i = first; i < last; i++) end += lines[i].style.size();
+
+  std::vector<Line> fresh(added + 1);
+  lines.erase(lines.begin() + first, lines.begin() + last);
+  lines.insert(lines.begin() + first, std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+
+  int lineStart = start;
+  for (int i = first; i <= first + added; i++) {
+    int lineEnd = textbuf->line_end(lineStart);
+    char* text = textbuf->text_range(lineStart, lineEnd);
+    parseLine(lines[i], text);
+    free(text);
+    lineStart = lineEnd + 1;
+  }
 
-  std::string style;
-  int basepoint = 0;
-  for (; it != end; ++it) {
-    std::string match = it->str();
-    int c1 = match.size();                    // the length of the word
-    int c2 = input.find(match, basepoint);    // the starting position of the word
-    for (int i = 0; i < c2 - basepoint; i++) style += ' ';
-    basepoint = c1 + c2;                      // start point for the find function for the next loop
-    if (styleMap.contains(match)) {
-      char styleType = styleMap.at(match);
-      // std::cout << match << " at position " << c2 << " of size " << c1 << " | start next check from " << basepoint << std::endl;
-      for (int i = 0; i < c1; i++) style += styleType;
+  highlight(start, end, first, first + added);
+  diagnose();
+}
+
+/**
+ * Lexes and parses a single line with the real lexer and parser, recording any error as a diagnostic. 
+ * Lines are lexed from line 0 and relocated when the program is run, so that inserting lines above 
+ * them does not invalidate them.
+ */
+void Editor::parseLine(Line& line, std::string_view text) {
+  line = Line();
+  line.style.assign(text.size(), 'A');
+
+  try {
+    lexer::Lexer lexer(text, 0);
+    while (lexer.peekToken().type() != lexer::ERROR) {
+      lexer::Token token = lexer.nextToken();
+      int end = lexer.position();
+      std::fill(line.style.begin() + end - token.size(), line.style.begin() + end, styleOf(token.type()));
+      line.tokens.push_back(token);
     }
-    else for (int i = 0; i < c1; i++) style += ' ';
+    if (!line.tokens.empty()) line.node.reset(parser::Parser::parseStatement(line.tokens));
+  }
+  // the report is built from its parts, since what() allocates a string it never frees
+  catch (const Error& e) {
+    line.error = e.message() + e.location() + "\n\t" + e.constructHelper();
+    line.message = e.message();
+  }
+  catch (const LexicalError& e) {
+    line.error = e.message() + e.location() + "\n\t" + e.constructHelper();
+    line.message = e.message();
   }
 
-  stylebuf->text(style.c_str());
+  if (!line.error.empty()) line.style.assign(text.size(), 'G');
 }
 
+/**
+ * Replaces the styles between start and end of the style buffer with the styles of the given range
+ * of lines, so that only the lines touched by an edit are restyled.
+ */
+void Editor::highlight(int start, int end, int first, int last) {
+  std::string style;
+  for (int i = first; i <= last; i++) {
+    style += lines[i].style;
+    if (i != last) style += 'A';                                          // newlines are unstyled
+  }
+
+  stylebuf->replace(start, end, style.c_str());
+}
+
+/**
+ * Shows the first error in the buffer in the status bar.
+ */
+void Editor::diagnose() {
+  auto line = std::find_if(lines.begin(), lines.end(), [](const Line& l){ return !l.error.empty(); });
+  if (line == lines.end()) status->label("");
+  else status->copy_label(("Line " + std::to_string(line - lines.begin() + 1) + ": " + line->message).c_str());
+}
+
+/**
+ * Marks the line the emulator is at, or none for -1. The buffer is only touched on the next refresh, since this 
+ * is called from the emulator thread.
+ */
 void Editor::highlightLine(int lineNumber) {
+  highlighted = lineNumber;
+}
+
+/**
+ * Hands over how often each line was reached in a profiled run, indexed by line number, to be shown on the 
+ * next refresh. Called from the emulator thread. No counts clears the heat map.
+ */
+void Editor::heat(std::vector<uint64_t> counts) {
+  std::lock_guard lock(heatMutex);
+  this->counts = std::move(counts);
+  heated = true;
+}
+
+/**
+ * Colours each line which was reached by how often it was run, relative to the hottest line, and puts the 
+ * syntax colours back on every other line. A line gets its syntax colours back as soon as it is edited.
+ */
+void Editor::restyle(const std::vector<uint64_t>& counts) {
+  uint64_t hottest = counts.empty() ? 0 : *std::max_element(counts.begin(), counts.end());
+
+  std::string style;
+  for (int i = 0; i < lines.size(); i++) {
+    uint64_t count = i + 1 < counts.size() ? counts[i + 1] : 0;
+    if (count) style.append(lines[i].style.size(), char('H' + count * 5 / (hottest + 1)));
+    else style += lines[i].style;
+    if (i != lines.size() - 1) style += 'A';
+  }
+
+  stylebuf->replace(0, stylebuf->length(), style.c_str());
+  editor->redisplay_range(0, textbuf->length());
+}
+
+/**
+ * Moves the highlight to the line last marked by the emulator, if it has changed, and redraws the heat map 
+ * if there is a new one. Called on the FLTK thread.
+ */
+void Editor::refresh() {
+  {
+    std::unique_lock lock(heatMutex);
+    if (heated) {
+      std::vector<uint64_t> counts = std::move(this->counts);
+      heated = false;
+      lock.unlock();
+      restyle(counts);
+    }
+  }
+
+  int lineNumber = highlighted;
+  if (lineNumber == shown) return;
+  shown = lineNumber;
+
   if (lineNumber == -1) {
     textbuf->highlight(0, 0);
     return;
@@ -166,10 +291,24 @@ void Editor::toggle() {
   else window->show();
 }
 
+/**
+ * Runs the buffer, reusing the statements already parsed for each line.
+ */
 void Editor::run() {
-  std::string program(textbuf->text());
+  std::vector<const syntax::Node*> statements;
+  for (int i = 0; i < lines.size(); i++) {
+    if (!lines[i].error.empty()) {
+      std::cerr << "Line " << i + 1 << ": " << lines[i].error << std::endl;
+      return;
+    }
+    statements.push_back(lines[i].node.get());
+  }
+
+  char* text = textbuf->text();
+  std::string program(text);
+  free(text);
 
-  try { emulator.run(program); }
+  try { emulator.run(program, statements); }
 			
   // Catch exception and print error
   catch(const std::exception &e) {
@@ -9,9 +9,13 @@
 #ifndef IRISC_EDITOR_H
 #define IRISC_EDITOR_H
 
-#include <map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
 #include <vector>
 #include <FL/Fl_Window.H>
+#include <FL/Fl_Box.H>
 #include <FL/Fl_Text_Editor.H>
 #include "../emulator/emulator.h"
 
@@ -26,14 +30,32 @@ namespace ui {
       // std::vector<std::string> lines();
   };
 
+  // The lexed and parsed form of a single line of the buffer, kept so that edits only reparse the lines they touch
+  struct Line {
+    std::vector<lexer::Token> tokens;
+    std::unique_ptr<syntax::Node> node;
+    std::string style;                    // one style character per character of the line
+    std::string error;                    // full error report, empty if the line is valid
+    std::string message;                  // short description of the error for the status bar
+  };
+
   class Editor {
     private:
       Fl_Window* window;
+      Fl_Box* status;
       vm::Emulator& emulator;
       Fl_Text_Buffer* stylebuf;
-      std::map<std::string, char> styleMap;
+      std::vector<Line> lines;
       bool cursorHidden;
-      void fetchStyles();
+      std::atomic<int> highlighted = -1;    // line the emulator is at, -1 for none
+      int shown = -1;                       // line currently highlighted in the buffer
+      std::mutex heatMutex;
+      std::vector<uint64_t> counts;         // times each line was reached in the last profiled run, by line number
+      bool heated = false;                  // set when the counts change, cleared once they are drawn
+      void parseLine(Line&, std::string_view);
+      void highlight(int, int, int, int);
+      void restyle(const std::vector<uint64_t>&);
+      void diagnose();
       
     public:
       Editor(vm::Emulator&);
@@ -41,8 +63,10 @@ namespace ui {
       Fl_Text_Editor* editor;
       void toggle();
       void blink();
-      void highlight();
+      void reparse(int, int, int, const char*);
       void highlightLine(int);
+      void heat(std::vector<uint64_t>);
+      void refresh();
       void run();
       void stop();
   };
@@ -1,6 +1,7 @@
-#include <regex>
 #include <string>
 #include <vector>
+#include <array>
+#include <bitset>
 #include <numeric>
 #include <cerrno>
 #include <cctype>
@@ -10,12 +11,18 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
 #include <FL/Fl.H>
 
 #include "../lexer/lexer.h"
 #include "../parser/parser.h"
 #include "../parser/constants.h"
 #include "../emulator/constants.h"
+#include "../error.h"
 #include "editor.h"
 
 #include "repl.h"
@@ -24,7 +31,13 @@
 using Replxx = replxx::Replxx;
 using namespace ui;
 
-REPL::REPL(Replxx& rx) : rx(rx), ops(), complexOps(), conds(), regs() {
+REPL::REPL(Replxx& rx) : rx(rx) {}
+
+/**
+ * Sets up history, key bindings and the completion, hint and colouring callbacks. This is only done for
+ * interactive sessions, so that scripted sessions pay nothing for them.
+ */
+void REPL::configure() {
 	rx.install_window_change_handler();
 
 	// the path to the history file
@@ -145,35 +158,42 @@ REPL::REPL(Replxx& rx) : rx(rx), ops(), complexOps(), conds(), regs() {
 }
 
 void REPL::fetchTokens() {
-	highlights = regex_color;
+	std::vector<std::string> ops, complexOps, regs;
 	for (auto const& [op, i] : syntax::opMap) {
-		ops.push_back(op);
+		ops.emplace_back(op);
 		for (auto flag : {"", "s"}) {
 			for (auto const& [cond, i] : syntax::condMap) {
-				complexOps.push_back(op + flag + cond);
-				highlights.push_back({op + flag + cond, replxx::Replxx::Color::BRIGHTRED});
+				complexOps.push_back(std::string(op) + flag + std::string(cond));
 			}
 		}
 	}
 
 	for (auto const& [op, i] : syntax::shiftMap) {
-		ops.push_back(op);
+		ops.emplace_back(op);
 		for (auto flag : {"", "s"}) {
 			for (auto const& [cond, i] : syntax::condMap) {
-				complexOps.push_back(op + flag + cond);
-				highlights.push_back({op + flag + cond, replxx::Replxx::Color::BRIGHTRED});
+				complexOps.push_back(std::string(op) + flag + std::string(cond));
 			}
 		}
 	}
 
 	for (auto const& [reg, i] : syntax::regMap) {
-		regs.push_back(reg);
-		highlights.push_back({reg, replxx::Replxx::Color::BRIGHTBLUE});
+		regs.emplace_back(reg);
 	}
+
+	this->ops.assign(ops);
+	this->complexOps.assign(complexOps);
+	this->regs.assign(regs);
+	this->dirs.assign(std::vector<std::string>(std::begin(directives), std::end(directives)));
 }
 
 void REPL::loop(vm::Emulator &emulator) {
-	Editor editor(emulator);
+	configure();
+	emulator.listen([this](const vm::Image& image) {
+		std::vector<std::string> labels;
+		for (auto const& [label, index] : image.labels) labels.emplace_back(lexer::name(label));
+		symbols.assign(labels);
+	});
 	std::cout << "\e[1miRISC\e[0m 0.0.1  [22nd Nov, 2020]" << std::endl;
   std::cout << "Type \":h\" for more information.\n" << std::endl;
 
@@ -205,13 +225,8 @@ void REPL::loop(vm::Emulator &emulator) {
 			break;
 		}
 
-		if (input == ":r" || input == ":reset") {
-			rx.history_add(input);
-			emulator.reset();
-		}
-
 		// help command
-		else if(input == ":h"){
+		if(input == ":h"){
 			rx.history_add(input);
 			std::cout << "\n" << "                            Welcome to " << 
 															"\033[3m" << "i" << "\033[0m" << "\033[1m" << "RISC"  << "\033[0m ";
@@ -226,6 +241,55 @@ void REPL::loop(vm::Emulator &emulator) {
 			std::cout <<         "" << "file into memory, e.g.\n";
 			std::cout <<         std::setw(18);
 			std::cout <<         "" << ">>> #load ~/hello_world.s\n\n";
+			std::cout <<         " :cache \e[1;3;4mdir\e[0m       Keeps assembled programs in the given directory so that\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "unchanged programs start without being reassembled.\n\n";
+			std::cout <<         " :break \e[1;3;4mline\e[0m      Pauses programs run from the editor before they execute the\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "given line. Use it again to remove the breakpoint.\n\n";
+			std::cout <<         " :profile on|off  Counts how often each instruction of a program runs, and shows\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "the hottest lines in the editor once it finishes.\n\n";
+			std::cout <<         " :profile \e[1;3;4mfile\e[0m    Prints the profile of the last program run, or writes it to\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "the given file.\n\n";
+			std::cout <<         " :profile sample \e[1;3;4mn\e[0m\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "Profiles, sampling the call stack every n instructions.\n\n";
+			std::cout <<         " :flame \e[1;3;4mfile\e[0m      Prints the calls of the last profiled program as a tree, or\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "writes its stacks to a file for flamegraph.pl or speedscope.\n\n";
+			std::cout <<         " :e               Shows or hides the editor, for running multi-line programs.\n\n";
+			std::cout <<         " :registers       Shows or hides the registers window.\n\n";
+			std::cout <<         " :machine         Shows or hides the machine code of the last instruction.\n\n";
+			std::cout <<         " :memory          Shows or hides the memory window.\n\n";
+			std::cout <<         " :s               Executes the next instruction of a paused program.\n\n";
+			std::cout <<         " :delay \e[1;3;4mms\e[0m        Sets the pause between instructions of a running program.\n\n";
+			std::cout <<         " :fps \e[1;3;4mhz\e[0m          Sets how many times a second the windows are redrawn.\n\n";
+			std::cout <<         " :timing \e[1;3;4mstages\e[0m   Estimates the cycles a program takes on a 3 or 5 stage pipeline,\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "shown by :state. Use ':timing off' to stop.\n\n";
+			std::cout <<         " :caches \e[1;3;4mlevels\e[0m   Simulates one or two levels of cache, each given as a size,\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "line size, ways and lru or plru, e.g. ':caches 1k 16 2 lru'.\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "On its own, shows the hits and misses of the last program's\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "instruction fetches.\n\n";
+			std::cout <<         " :predict \e[1;3;4mnames\e[0m   Compares branch predictors on the same run, any of static,\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "bimodal and gshare. The first decides the cycles lost to\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "mispredictions. On its own, shows how each predictor did.\n\n";
+			std::cout <<         " :trace \e[1;3;4mfile\e[0m      Records every instruction executed in a binary trace file, read\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "back with irisc-trace. ':trace ring n' keeps the last n in\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "memory instead, ':trace save file' writes them out and ':trace'\n";
+			std::cout <<         std::setw(18);
+			std::cout <<         "" << "on its own shows the latest. Use ':trace off' to stop.\n\n";
+			std::cout <<         " :continue        Continues a paused program.\n\n";
+			std::cout <<         " :state           Shows the registers, flags and number of instructions executed.\n\n";
 			std::cout <<         " :q               Exits the interactive RISC program.\n\n";
 			std::cout <<         " :c               Clears the terminal window." << std::endl;
 		}
@@ -237,27 +301,25 @@ void REPL::loop(vm::Emulator &emulator) {
 		}
 
 		else if (input == ":e" || input == ":editor") {
-			editor.toggle();
+			if (!editor) editor = std::make_unique<Editor>(emulator);
+			editor->toggle();
 		}
 
-		else if (input == ".text") {
-			prompt = "\033[32miRISC\033[0m \033[95m.text\033[0m$ ";
-			emulator.mode(vm::TEXT);
-		}
-		else if (input == ".data") {
-			prompt = "\033[32miRISC\033[0m \033[95m.data\033[0m$ ";
-			emulator.mode(vm::DATA);
-		}
+		else if (input == ":registers") emulator.toggle(vm::REGISTERS);
+		else if (input == ":machine") emulator.toggle(vm::MACHINE_CODE);
+		else if (input == ":memory") emulator.toggle(vm::MEMORY);
 
-		// Parse as assembler
+		// commands shared with scripts, and statements parsed as assembler
 		else {
-			try { emulator.execute(input); }
+			try { execute(input, emulator); }
 			
 			// Catch exception and print error
 			catch(const std::exception &e) {
 				std::cerr << e.what() << std::endl;
 			}
 
+			if (input == ".text") prompt = "\033[32miRISC\033[0m \033[95m.text\033[0m$ ";
+			if (input == ".data") prompt = "\033[32miRISC\033[0m \033[95m.data\033[0m$ ";
 			rx.history_add(input);
 		}
 	}
@@ -267,9 +329,12 @@ void REPL::loop(vm::Emulator &emulator) {
 }
 
 
-Replxx::completions_t REPL::hook_completion(std::string const& context, int& contextLen) {
-	Replxx::completions_t completions;
-
+/**
+ * Finds the words which could complete the last word of the context. The first word of a statement is
+ * completed from the operations and directives; later words from the registers and the labels of the 
+ * loaded program.
+ */
+std::vector<std::string> REPL::complete(std::string const& context, int& contextLen) {
 	int tokens = 1;
 	std::for_each(context.begin(), context.end(), [&tokens](char e){ if (isspace(e)) tokens++; });
 
@@ -282,80 +347,30 @@ Replxx::completions_t REPL::hook_completion(std::string const& context, int& con
 	contextLen = utf8str_codepoint_len( context.c_str() + prefixLen, utf8ContextLen );
 
 	std::string prefix { context.substr(prefixLen) };
-	if (prefix.size() >= 1) {
-		if (prefix[0] == '.') {
-			for (auto const& e : directives) {
-				if (e.compare(0, prefix.size(), prefix) == 0) {
-					completions.emplace_back(e.c_str());
-				}
-			}
-		}
+	if (prefix.size() < 1) return {};
 
-		else if (tokens == 1) {									// operation completion
-			if (prefix.size() < 3) {
-				for (auto const& e : ops) {
-					if (e.compare(0, prefix.size(), prefix) == 0) {
-						completions.emplace_back(e.c_str());
-					}
-				}
-			}
-			else {
-				for (auto const& e : complexOps) {
-					if (e.compare(0, prefix.size(), prefix) == 0) {
-						completions.emplace_back(e.c_str());
-					}
-				}
-			}
-		}
+	if (prefix[0] == '.') return dirs.complete(prefix);
+	if (tokens == 1) {																		// operation completion
+		if (prefix.size() < 3) return ops.complete(prefix);
+		else return complexOps.complete(prefix);
 	}
 
+	std::vector<std::string> operands = regs.complete(prefix);		// operand completion
+	std::vector<std::string> labels = symbols.complete(prefix);
+	operands.insert(operands.end(), labels.begin(), labels.end());
+	return operands;
+}
+
+Replxx::completions_t REPL::hook_completion(std::string const& context, int& contextLen) {
+	Replxx::completions_t completions;
+	for (auto const& e : complete(context, contextLen)) completions.emplace_back(e.c_str());
+
 	return completions;
 }
 
 Replxx::hints_t REPL::hook_hint(std::string const& context, int& contextLen, Replxx::Color& color) {
 	Replxx::hints_t hints;
-
-	// std::cout << context << std::endl;
-	int tokens = 1;
-	std::for_each(context.begin(), context.end(), [&tokens](char e){ if (isspace(e)) tokens++; });
-	// std::cout << tokens << std::endl;
-	
-	// only show hint if prefix is at least 'n' chars long
-	// or if prefix begins with a specific character
-
-	int utf8ContextLen( context_len( context.c_str() ) );
-	int prefixLen( context.length() - utf8ContextLen );
-	contextLen = utf8str_codepoint_len( context.c_str() + prefixLen, utf8ContextLen );
-	std::string prefix { context.substr(prefixLen) };
-	// std::cout << "\n  prefic: " << prefix << std::endl;
-
-	if (prefix.size() >= 1) {
-		if (prefix[0] == '.') {
-			for (auto const& e : directives) {
-				if (e.compare(0, prefix.size(), prefix) == 0) {
-					hints.emplace_back(e.c_str());
-				}
-			}
-		}
-
-		else if (tokens == 1) {									// operation completion
-			if (prefix.size() < 3) {
-				for (auto const& e : ops) {
-					if (e.compare(0, prefix.size(), prefix) == 0) {
-						hints.emplace_back(e.c_str());
-					}
-				}
-			}
-			else {
-				for (auto const& e : complexOps) {
-					if (e.compare(0, prefix.size(), prefix) == 0) {
-						hints.emplace_back(e.c_str());
-					}
-				}
-			}
-		}
-	}
-	
+	for (auto const& e : complete(context, contextLen)) hints.emplace_back(e.c_str());
 
 	// set hint color to green if single match found
 	// if (hints.size() == 1) {
@@ -365,40 +380,254 @@ Replxx::hints_t REPL::hook_hint(std::string const& context, int& contextLen, Rep
 	return hints;
 }
 
+/**
+ * The colour used to highlight each type of token in the REPL.
+ */
+static Replxx::Color colorOf(lexer::TOKEN type) {
+	switch (type) {
+		case lexer::BRANCH:
+		case lexer::BI_OPERAND:
+		case lexer::TRI_OPERAND:
+		case lexer::LOAD_STORE:
+		case lexer::SHIFT:
+			return Replxx::Color::BRIGHTRED;
+		case lexer::REGISTER:
+			return Replxx::Color::BRIGHTBLUE;
+		case lexer::IMM_BIN:
+		case lexer::IMM_OCT:
+		case lexer::IMM_DEC:
+		case lexer::IMM_HEX:
+			return Replxx::Color::GRAY;
+		case lexer::DIRECTIVE:
+			return Replxx::Color::BRIGHTMAGENTA;
+		default:
+			return Replxx::Color::DEFAULT;
+	}
+}
+
+/**
+ * Classifies the line in a single pass of the lexer DFA, colouring each token by its type. Anything
+ * after the first lexical error is left uncoloured, since it is usually a token still being typed.
+ */
 void REPL::hook_color(std::string const& context, Replxx::colors_t& colors) {
-	std::vector<std::string> tokens;
-	std::vector<int> offsets;
-	std::regex words_regex("[\\s,]|[^\\s,]+");
-	auto words_begin = std::sregex_iterator(context.begin(), context.end(), words_regex);
-	auto words_end = std::sregex_iterator();
-	for (std::sregex_iterator i = words_begin; i != words_end; ++i) tokens.push_back(i->str());
-
-	// highlight matching regex sequences
-	int offset = 0;
-	for (std::string token : tokens) {
-		for (auto const& e : highlights) {
-			size_t pos {0};
-			std::string str = token;
-			std::smatch match;
-
-			while(std::regex_match(str, match, std::regex(e.first))) {
-				std::string c{ match[0] };
-				std::string prefix( match.prefix().str() );
-				pos += utf8str_codepoint_len( prefix.c_str(), static_cast<int>( prefix.length() ) );
-				int len( utf8str_codepoint_len( c.c_str(), static_cast<int>( c.length() ) ) );
-
-				for (int i = 0; i < len; ++i) {
-					colors.at(pos + i + offset) = e.second;
-				}
-
-				pos += len;
-				str = match.suffix();
-			}
+	lexer::Lexer lexer(context, 0);
+	int bytes = 0;										// colours are indexed by codepoint rather than by byte
+	int codepoints = 0;
+
+	try {
+		while (lexer.peekToken().type() != lexer::ERROR) {
+			lexer::Token token = lexer.nextToken();
+			int end = lexer.position();
+			int start = end - token.size();
+
+			codepoints += utf8str_codepoint_len(context.c_str() + bytes, start - bytes);
+			int len = utf8str_codepoint_len(context.c_str() + start, end - start);
+			bytes = end;
+
+			Replxx::Color color = colorOf(token.type());
+			for (int i = codepoints; i < codepoints + len && i < colors.size(); i++) colors[i] = color;
+			codepoints += len;
+		}
+	}
+	catch (const LexicalError&) {}
+}
+
+/**
+ * Reads the number which follows a command, throwing with the given message if there isn't exactly one.
+ */
+static unsigned int argument(std::string const& input, size_t offset, const char* message) {
+	unsigned int value = 0;
+	auto [end, error] = std::from_chars(input.data() + offset, input.data() + input.size(), value);
+	if (error != std::errc() || end != input.data() + input.size()) throw std::invalid_argument(message);
+	return value;
+}
+
+/**
+ * Writes a report out to a file.
+ */
+static void save(std::string const& report, std::string const& path) {
+	std::ofstream file(path);
+	if (!(file << report)) throw std::runtime_error("Couldn't write to '" + path + "'.");
+}
+
+/**
+ * Reads the levels of a ':caches' command, each a size, line size and associativity followed by an optional
+ * replacement policy. Sizes may be given in kilobytes with a 'k' suffix.
+ */
+static std::vector<vm::CacheLevel::Config> caches(std::string const& input) {
+	std::istringstream words(input);
+	std::vector<std::string> fields {std::istream_iterator<std::string>(words), std::istream_iterator<std::string>()};
+
+	auto number = [](std::string field) {
+		unsigned int scale = 1;
+		if (!field.empty() && (field.back() == 'k' || field.back() == 'K')) {
+			field.pop_back();
+			scale = 1024;
+		}
+		uint64_t value = uint64_t(argument(field, 0, "Expected a cache as a size, line size and associativity, e.g. ':caches 4k 32 2 lru'.")) * scale;
+		if (value > UINT32_MAX) throw std::invalid_argument("Cache sizes must fit in 32 bits.");
+		return uint32_t(value);
+	};
+
+	std::vector<vm::CacheLevel::Config> levels;
+	for (size_t i = 0; i < fields.size(); i += 3) {
+		if (i + 3 > fields.size()) throw std::invalid_argument("Expected a cache as a size, line size and associativity, e.g. ':caches 4k 32 2 lru'.");
+
+		vm::CacheLevel::Config level { number(fields[i]), number(fields[i + 1]), number(fields[i + 2]) };
+		if (i + 3 < fields.size() && (fields[i + 3] == "lru" || fields[i + 3] == "plru")) {
+			level.policy = fields[i + 3] == "lru" ? vm::CacheLevel::LRU : vm::CacheLevel::PLRU;
+			i++;
 		}
+		levels.push_back(level);
+	}
+	return levels;
+}
 
-		offset += token.size();
+/**
+ * Reads the predictors named by a ':predict' command.
+ */
+static std::vector<vm::Predictor::KIND> predictors(std::string const& input) {
+	std::istringstream words(input);
+	std::vector<vm::Predictor::KIND> kinds;
+	for (std::string word; words >> word;) {
+		std::optional<vm::Predictor::KIND> kind = lookup::find(vm::predictorMap, word);
+		if (!kind) throw std::invalid_argument("Unknown branch predictor '" + word + "'. Try static, bimodal or gshare.");
+		kinds.push_back(*kind);
 	}
-	
+	return kinds;
+}
+
+/**
+ * Prints the most recent records of the current trace, numbered from the oldest.
+ */
+static void trace(vm::Emulator& emulator) {
+	std::vector<vm::Record> records = emulator.traced(20);
+	for (size_t i = 0; i < records.size(); i++) std::cout << vm::Trace::format(records[i], i + 1) << '\n';
+	std::cout << std::flush;
+}
+
+/**
+ * Handles a line which means the same thing in interactive and scripted sessions: a reset, a cache directory,
+ * a section switch, or otherwise a statement to be executed. Errors are left for the caller to report.
+ */
+void REPL::execute(std::string const& input, vm::Emulator& emulator) {
+	if (input == ":r" || input == ":reset") emulator.reset();
+	else if (input == ":s" || input == ":step") emulator.step();
+	else if (input == ":continue") emulator.resume();
+	else if (input == ":state") inspect(emulator.snapshot());
+	else if (input.rfind(":break ", 0) == 0) emulator.breakpoint(argument(input, 7, "Expected a line number after ':break'."));
+	else if (input.rfind(":delay ", 0) == 0) emulator.stepDelay(argument(input, 7, "Expected a number of milliseconds after ':delay'."));
+	else if (input.rfind(":fps ", 0) == 0) emulator.frameRate(argument(input, 5, "Expected a number of refreshes per second after ':fps'."));
+	else if (input.rfind(":cache ", 0) == 0) emulator.cacheDirectory(input.substr(7));
+	else if (input == ":profile on") emulator.profile(1);
+	else if (input == ":profile off") emulator.profile(0);
+	else if (input.rfind(":profile sample ", 0) == 0) emulator.profile(std::max(argument(input, 16, "Expected a number of instructions after ':profile sample'."), 1u));
+	else if (input == ":profile") std::cout << emulator.report() << std::flush;
+	else if (input.rfind(":profile ", 0) == 0) save(emulator.report(), input.substr(9));
+	else if (input == ":timing off") emulator.time(0);
+	else if (input.rfind(":timing ", 0) == 0) emulator.time(argument(input, 8, "Expected a number of pipeline stages after ':timing'."));
+	else if (input == ":caches off") emulator.simulate({});
+	else if (input == ":caches") std::cout << emulator.cacheReport() << std::flush;
+	else if (input.rfind(":caches ", 0) == 0) emulator.simulate(caches(input.substr(8)));
+	else if (input == ":predict off") emulator.predict({});
+	else if (input == ":predict") std::cout << emulator.predictionReport() << std::flush;
+	else if (input.rfind(":predict ", 0) == 0) emulator.predict(predictors(input.substr(9)));
+	else if (input == ":trace off") emulator.trace(nullptr);
+	else if (input == ":trace") trace(emulator);
+	else if (input.rfind(":trace ring ", 0) == 0) emulator.trace(std::make_unique<vm::Trace>(size_t(argument(input, 12, "Expected a number of records after ':trace ring'."))));
+	else if (input.rfind(":trace save ", 0) == 0) emulator.saveTrace(input.substr(12));
+	else if (input.rfind(":trace ", 0) == 0) emulator.trace(std::make_unique<vm::Trace>(input.substr(7)));
+	else if (input == ":flame") std::cout << emulator.report(vm::Profiler::TREE) << std::flush;
+	else if (input.rfind(":flame ", 0) == 0) save(emulator.report(vm::Profiler::FOLDED), input.substr(7));
+	else if (input == ".text") emulator.mode(vm::TEXT);
+	else if (input == ".data") emulator.mode(vm::DATA);
+	else emulator.execute(input);
+}
+
+/**
+ * Prints a snapshot of the machine state, four registers to a row. Registers written by the last instruction
+ * are marked with an asterisk.
+ */
+void REPL::inspect(const vm::State& state) {
+	std::array<std::string, 16> names;
+	for (auto const& [name, index] : syntax::regMap) names[index] = std::string(name);
+
+	std::ios flags(nullptr);
+	flags.copyfmt(std::cout);
+
+	for (int i = 0; i < 16; i++) {
+		std::cout << std::left << std::setw(4) << std::setfill(' ') << names[i] 
+							<< "0x" << std::right << std::setw(8) << std::setfill('0') << std::hex << state.registers[i] << std::dec
+							<< (state.changed & (1 << i) ? '*' : ' ')
+							<< (i % 4 == 3 ? '\n' : ' ');
+	}
+	std::cout.copyfmt(flags);
+
+	std::cout << "nzcv " << std::bitset<4>(state.cpsr >> 28) << "   " << state.steps << " steps, ";
+	if (state.cycles) std::cout << state.cycles << " cycles, ";
+	std::cout << (state.running ? "running" : "stopped") << std::endl;
+}
+
+/**
+ * Prints what a scripted statement did on one line: its line number, then each register it wrote and the
+ * flags if it set them, e.g. "3: r0=0x00000001 nzcv=0100". A statement whose condition failed wrote nothing
+ * and is shown with a "-".
+ */
+static void result(unsigned int line, const vm::State& state, const std::array<std::string, 16>& names) {
+	std::ostringstream out;
+	out << line << ':' << std::hex << std::setfill('0');
+	for (int i = 0; i < 16; i++) {
+		if (state.changed & (1 << i)) out << ' ' << names[i] << "=0x" << std::setw(8) << state.registers[i];
+	}
+	if (state.flagged) out << " nzcv=" << std::bitset<4>(state.cpsr >> 28);
+	if (!state.changed && !state.flagged) out << " -";
+	std::cout << out.str() << '\n';
+}
+
+/**
+ * Runs a script line by line without any of the interactive machinery. Each statement executed prints a
+ * single line of what it wrote, and each error is reported on a single line prefixed with its line number,
+ * followed by a summary once the script ends or reaches ":q". Returns the number of lines which failed.
+ */
+int REPL::script(std::istream& in, vm::Emulator& emulator) {
+	std::string input;
+	unsigned int line = 0;
+	int errors = 0;
+
+	std::array<std::string, 16> names;
+	for (auto const& [name, index] : syntax::regMap) names[index] = std::string(name);
+
+	while (std::getline(in, input)) {
+		line++;
+		if (!input.empty() && input.back() == '\r') input.pop_back();
+		if (input.empty()) continue;
+		if (input == ":q") break;
+		if (input == ":h" || input == ":c" || input == ":e" || input == ":editor" ||
+				input == ":registers" || input == ":machine" || input == ":memory") continue;		// only meaningful interactively
+
+		try {
+			uint64_t steps = emulator.snapshot().steps;
+			execute(input, emulator);
+
+			vm::State state = emulator.snapshot();
+			if (input[0] != ':' && state.steps != steps) result(line, state, names);		// commands print their own output
+		}
+		catch (const Error &e) {
+			std::cerr << line << ": " << e.message() << '\n';
+			errors++;
+		}
+		catch (const LexicalError &e) {
+			std::cerr << line << ": " << e.message() << '\n';
+			errors++;
+		}
+		catch (const std::exception &e) {
+			std::cerr << line << ": " << e.what() << '\n';
+			errors++;
+		}
+	}
+
+	std::cout << line << " lines, " << errors << " errors" << std::endl;
+	return errors;
 }
 
 Replxx::ACTION_RESULT REPL::message( Replxx& replxx, std::string s, char32_t ) {
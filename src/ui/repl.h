@@ -2,9 +2,12 @@
 #define IRISC_REPL_H
 
 #include <thread>
+#include <istream>
+#include <memory>
 #include "replxx.hxx"
 #include "../emulator/emulator.h"
 #include "constants.h"
+#include "dictionary.h"
 
 namespace ui {
   // prototypes
@@ -14,17 +17,22 @@ namespace ui {
     private: 
       replxx::Replxx &rx;
       std::string history_file;
-      std::vector<std::string> ops;
-      std::vector<std::string> complexOps;
-      std::vector<std::string> regs;
-      std::vector<std::string> conds;
-      std::vector<std::pair<std::string, replxx::Replxx::Color>> highlights;
+      Dictionary ops;
+      Dictionary complexOps;
+      Dictionary regs;
+      Dictionary dirs;
+      Dictionary symbols;                   // labels in the most recently assembled program
+      std::unique_ptr<Editor> editor;       // built the first time it is opened
+      void configure();
       void fetchTokens();
-      void fetchHighlights();
+      void execute(std::string const&, vm::Emulator&);
+      void inspect(const vm::State&);
+      std::vector<std::string> complete(std::string const&, int&);
     
     public:
       REPL(replxx::Replxx&);
       void loop(vm::Emulator&);
+      int script(std::istream&, vm::Emulator&);
       replxx::Replxx::completions_t hook_completion(std::string const& context, int& contextLen);
       replxx::Replxx::hints_t hook_hint(std::string const& context, int& contextLen, replxx::Replxx::Color& color);
       void hook_color(std::string const& str, replxx::Replxx::colors_t& colors);
@@ -0,0 +1,22 @@
+/**
+ * @file assemble.h
+ * Assembles a program for tests which need an image to work on.
+ */
+
+#ifndef IRISC_TESTS_ASSEMBLE_H
+#define IRISC_TESTS_ASSEMBLE_H
+
+#include <memory>
+#include <string_view>
+#include "../src/emulator/assembler.h"
+#include "../src/emulator/windows/memory.h"
+
+inline std::shared_ptr<vm::Image> assemble(std::string_view source) {
+    vm::Memory memory;
+    memory.softReset();
+    vm::Assembler assembler(memory);
+    assembler.assemble(source);
+    return memory.image();
+}
+
+#endif //IRISC_TESTS_ASSEMBLE_H
@@ -0,0 +1,66 @@
+#include <catch2/catch_all.hpp>
+#include <cstdint>
+#include <thread>
+#include "../src/emulator/channel.h"
+#include "../src/emulator/snapshot.h"
+
+TEST_CASE( "A channel hands values over in order until it is full", "[channel]" ) {
+    vm::Channel<int, 4> channel;
+    int value = 0;
+
+    REQUIRE_FALSE( channel.pop(value) );
+    for (int i = 0; i < 4; i++) REQUIRE( channel.push(int(i)) );
+    REQUIRE_FALSE( channel.push(4) );
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE( channel.pop(value) );
+        REQUIRE( value == i );
+    }
+    REQUIRE_FALSE( channel.pop(value) );
+    REQUIRE( channel.push(5) );                                     // slots are reused once read
+}
+
+TEST_CASE( "A channel loses nothing between two threads", "[channel]" ) {
+    constexpr int count = 200000;
+    vm::Channel<int, 64> channel;
+
+    std::thread producer([&] {
+        for (int i = 0; i < count; i++) while (!channel.push(int(i))) std::this_thread::yield();
+    });
+
+    int expected = 0;
+    bool ordered = true;
+    while (expected < count) {
+        int value;
+        if (!channel.pop(value)) continue;
+        ordered &= value == expected++;
+    }
+    producer.join();
+
+    REQUIRE( ordered );
+}
+
+TEST_CASE( "A seqlock never shows a reader a half written value", "[seqlock]" ) {
+    struct Triple { uint64_t a, b, c; };
+    constexpr uint64_t count = 200000;
+    vm::Seqlock<Triple> lock;
+    lock.publish({0, 0, 0});
+
+    std::thread writer([&] {
+        for (uint64_t i = 1; i <= count; i++) lock.publish({i, i, i});
+    });
+
+    bool whole = true;
+    bool forwards = true;
+    uint64_t last = 0;
+    while (last < count) {
+        Triple value = lock.read();
+        whole &= value.a == value.b && value.b == value.c;
+        forwards &= value.a >= last;
+        last = value.a;
+    }
+    writer.join();
+
+    REQUIRE( whole );
+    REQUIRE( forwards );
+}
@@ -0,0 +1,75 @@
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "../src/emulator/emulator.h"
+#include "../src/emulator/hierarchy.h"
+
+// one set of four 16 byte lines, so that every address below competes for the same ways
+static constexpr uint32_t A = 0, B = 16, C = 32, D = 48, E = 64;
+
+TEST_CASE( "An LRU cache replaces the line used longest ago", "[cache]" ) {
+    vm::CacheLevel cache({64, 16, 4, vm::CacheLevel::LRU});
+
+    for (uint32_t address : {A, B, C, D}) REQUIRE_FALSE( cache.access(address) );
+    REQUIRE( cache.access(A) );
+    REQUIRE_FALSE( cache.access(E) );                               // replaces B
+    REQUIRE( cache.access(A) );
+    REQUIRE_FALSE( cache.access(B) );                               // replaces C
+    REQUIRE( cache.access(D) );
+    REQUIRE_FALSE( cache.access(C) );
+
+    REQUIRE( cache.hits() == 3 );
+    REQUIRE( cache.misses() == 7 );
+}
+
+TEST_CASE( "A PLRU cache replaces the line its tree points to", "[cache]" ) {
+    vm::CacheLevel cache({64, 16, 4, vm::CacheLevel::PLRU});
+
+    for (uint32_t address : {A, B, C, D}) REQUIRE_FALSE( cache.access(address) );
+    REQUIRE( cache.access(A) );
+    REQUIRE_FALSE( cache.access(E) );                               // the tree points away from A and D, to C
+    REQUIRE( cache.access(B) );                                     // which LRU would have replaced
+    REQUIRE_FALSE( cache.access(C) );
+}
+
+TEST_CASE( "Clearing a cache empties it and its counts", "[cache]" ) {
+    vm::CacheLevel cache({64, 16, 4, vm::CacheLevel::LRU});
+    cache.access(A);
+    cache.access(A);
+    cache.clear();
+
+    REQUIRE( cache.hits() == 0 );
+    REQUIRE( cache.misses() == 0 );
+    REQUIRE_FALSE( cache.access(A) );
+}
+
+TEST_CASE( "Impossible cache shapes are refused", "[cache]" ) {
+    REQUIRE_THROWS_AS( vm::CacheLevel({100, 16, 2}), std::invalid_argument );
+    REQUIRE_THROWS_AS( vm::CacheLevel({64, 2, 2}), std::invalid_argument );
+    REQUIRE_THROWS_AS( vm::CacheLevel({32, 16, 4}), std::invalid_argument );
+    REQUIRE_THROWS_AS( vm::CacheLevel({4096, 2147483648u, 4}), std::invalid_argument );    // line * ways wraps in 32 bits
+}
+
+TEST_CASE( "Straight line code is fetched sixteen instructions to a 64 byte line", "[cache]" ) {
+    std::string program = "main:\n";
+    for (int i = 0; i < 32; i++) program += "  mov r0, #" + std::to_string(i) + "\n";
+
+    vm::Emulator emulator;
+    emulator.stepDelay(0);
+    emulator.simulate({{1024, 64, 1}});
+    emulator.run(program);
+
+    auto start = std::chrono::steady_clock::now();
+    while (emulator.snapshot().steps != 32 || emulator.snapshot().running) {
+        REQUIRE( std::chrono::steady_clock::now() - start < std::chrono::seconds(10) );
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::string report = emulator.cacheReport();
+    emulator.shutdown();
+
+    INFO( report );
+    REQUIRE( report.find("   L1      1024    64     1     lru          30           2     6.2") != std::string::npos );
+}
@@ -1,5 +1,11 @@
 // #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 #include <catch2/catch_all.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/lexer/lexer.h"
+#include "../src/lexer/symbol.h"
+#include "../src/lexer/token.h"
 
 unsigned int Factorial( unsigned int number ) {
     return number <= 1 ? number : Factorial(number-1)*number;
@@ -10,4 +16,88 @@ TEST_CASE( "Factorials are computed", "[factorial]" ) {
     REQUIRE( Factorial(2) == 2 );
     REQUIRE( Factorial(3) == 6 );
     REQUIRE( Factorial(10) == 3628800 );
-}
\ No newline at end of file
+}
+
+TEST_CASE( "Equal text is interned as the same symbol", "[symbol]" ) {
+    lexer::Symbol loop = lexer::intern("loop");
+    std::string built = std::string("lo") + "op";
+
+    REQUIRE( lexer::intern(built) == loop );
+    REQUIRE( lexer::intern("pool") != loop );
+    REQUIRE( lexer::name(loop) == "loop" );
+    REQUIRE( lexer::intern("") == lexer::Symbol{} );
+}
+
+TEST_CASE( "Names can be read while others are being interned", "[symbol]" ) {
+    std::vector<lexer::Symbol> symbols;
+    for (int i = 0; i < 100; i++) symbols.push_back(lexer::intern("read" + std::to_string(i)));
+
+    std::thread writer([] {
+        for (int i = 0; i < 20000; i++) lexer::intern("written" + std::to_string(i));
+    });
+    bool intact = true;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 100; i++) intact &= lexer::name(symbols[i]) == "read" + std::to_string(i);
+    }
+    writer.join();
+
+    REQUIRE( intact );
+    REQUIRE( lexer::name(lexer::intern("written19999")) == "written19999" );
+}
+
+TEST_CASE( "Tokens decode their operands when they are made", "[token]" ) {
+    REQUIRE( lexer::Token(lexer::REGISTER, "r12").reg() == 12 );
+    REQUIRE( lexer::Token(lexer::REGISTER, "sp").reg() == 13 );
+    REQUIRE( lexer::Token(lexer::REGISTER, "lr").reg() == 14 );
+    REQUIRE( lexer::Token(lexer::REGISTER, "pc").reg() == 15 );
+
+    REQUIRE( lexer::Token(lexer::IMM_DEC, "#42").immediate() == 42 );
+    REQUIRE( lexer::Token(lexer::IMM_HEX, "#0xff").immediate() == 255 );
+    REQUIRE( lexer::Token(lexer::IMM_BIN, "#0b101").immediate() == 5 );
+    REQUIRE( lexer::Token(lexer::HEX, "0x100000000").immediate() == 0x100000000 );     // wider than the payload
+
+    REQUIRE( lexer::Token(lexer::LABEL, "loop:").symbol() == lexer::intern("loop") );
+    REQUIRE( lexer::Token(lexer::VARIABLE, "=value").symbol() == lexer::intern("value") );
+    REQUIRE( lexer::Token(lexer::OP_LABEL, "loop").symbol() == lexer::intern("loop") );
+}
+
+TEST_CASE( "Token text is rebuilt from what the token decoded", "[token]" ) {
+    lexer::Token op(lexer::TRI_OPERAND, "addseq");
+    REQUIRE( op.value() == "addseq" );
+    REQUIRE( op.mnemonic() == std::tuple<std::string_view, std::string_view, std::string_view> {"add", "s", "eq"} );
+    REQUIRE( lexer::Token(lexer::BRANCH, "bl").mnemonic() == std::tuple<std::string_view, std::string_view, std::string_view> {"bl", "", ""} );
+
+    REQUIRE( lexer::Token(lexer::REGISTER, "lr").value() == "lr" );
+    REQUIRE( lexer::Token(lexer::IMM_DEC, "#42").value() == "#42" );
+    REQUIRE( lexer::Token(lexer::IMM_BIN, "#0b101").value() == "#0b101" );
+    REQUIRE( lexer::Token(lexer::OCT, "017").value() == "017" );
+    REQUIRE( lexer::Token(lexer::COMMA, ",").value() == "," );
+    REQUIRE( lexer::Token(lexer::LABEL, "loop:").value() == "loop:" );
+    REQUIRE( lexer::Token(lexer::VARIABLE, "=value").value() == "=value" );
+
+    lexer::Token padded(lexer::IMM_HEX, "#0x0010");
+    REQUIRE( padded.value() == "#0x10" );
+    REQUIRE( padded.size() == 7 );                                                      // as typed, for highlighting
+
+    REQUIRE( lexer::Token(lexer::REGISTER, "r99").type() == lexer::ERROR );            // text which doesn't fit its type
+    REQUIRE( lexer::Token(lexer::BI_OPERAND, "movxx").type() == lexer::ERROR );
+}
+
+TEST_CASE( "The lexer splits a statement into decoded tokens", "[lexer]" ) {
+    lexer::Lexer lexer("ADD r1, r2, #0x10");
+
+    lexer::Token op = lexer.nextToken();
+    REQUIRE( op.type() == lexer::TRI_OPERAND );
+    REQUIRE( op.value() == "add" );                                                     // lowercased
+    REQUIRE( op.size() == 3 );
+
+    REQUIRE( lexer.nextToken().reg() == 1 );
+    REQUIRE( lexer.nextToken().type() == lexer::COMMA );
+    REQUIRE( lexer.nextToken().reg() == 2 );
+    REQUIRE( lexer.nextToken().type() == lexer::COMMA );
+
+    lexer::Token imm = lexer.nextToken();
+    REQUIRE( imm.type() == lexer::IMM_HEX );
+    REQUIRE( imm.immediate() == 16 );
+    REQUIRE( imm.tokenNumber() == 5 );
+}
@@ -0,0 +1,73 @@
+#include <catch2/catch_all.hpp>
+#include <initializer_list>
+#include "../src/emulator/predictor.h"
+#include "assemble.h"
+
+// mispredictions of a predictor over a run of outcomes at one branch
+static int misses(vm::Predictor& predictor, std::initializer_list<bool> outcomes, size_t site = 5) {
+    int wrong = 0;
+    for (bool taken : outcomes) {
+        wrong += predictor.predict(site, false) != taken;
+        predictor.update(site, taken);
+    }
+    return wrong;
+}
+
+TEST_CASE( "A bimodal predictor takes two wrong guesses to change its mind", "[predictor]" ) {
+    vm::BimodalPredictor bimodal;
+    REQUIRE( misses(bimodal, {true, true, true, true}) == 1 );     // starts weakly not taken
+    REQUIRE( misses(bimodal, {false, true, true}) == 1 );           // one not taken doesn't flip a strong counter
+    REQUIRE( misses(bimodal, {false, false, false}) == 2 );
+
+    bimodal.clear();
+    REQUIRE( misses(bimodal, {true}) == 1 );
+}
+
+TEST_CASE( "A gshare predictor learns a pattern a bimodal one cannot", "[predictor]" ) {
+    vm::BimodalPredictor bimodal;
+    vm::GsharePredictor gshare;
+
+    int bimodalMisses = 0;
+    int gshareMisses = 0;
+    for (int i = 0; i < 1000; i++) {
+        bool taken = i % 2 == 0;
+        bimodalMisses += misses(bimodal, {taken});
+        gshareMisses += misses(gshare, {taken});
+    }
+
+    REQUIRE( bimodalMisses == 1000 );                               // flips between weakly taken and not taken
+    REQUIRE( gshareMisses < 20 );
+}
+
+TEST_CASE( "A static predictor takes backward branches", "[predictor]" ) {
+    vm::StaticPredictor predictor;
+    REQUIRE( predictor.predict(0, true) );
+    REQUIRE_FALSE( predictor.predict(0, false) );
+}
+
+TEST_CASE( "The return address stack forgets the oldest call once it is full", "[predictor]" ) {
+    auto image = assemble("main:\n  bl f\n  b end\nf:\n  bl f\n  bx lr\nend:\n  mov r0, #0\n");
+    vm::Predictors predictors({vm::Predictor::STATIC});
+    predictors.reset(*image);
+
+    REQUIRE_FALSE( predictors.resolve(0, true, 2) );                // main calls f
+    for (int i = 0; i < 8; i++) REQUIRE_FALSE( predictors.resolve(2, true, 2) );      // and f itself, eight deep
+
+    for (int i = 0; i < 8; i++) REQUIRE_FALSE( predictors.resolve(3, true, 3) );      // the stack holds eight returns
+    REQUIRE( predictors.resolve(3, true, 1) );                      // the return to main was pushed out
+}
+
+TEST_CASE( "The first predictor decides which conditional branches were mispredicted", "[predictor]" ) {
+    auto image = assemble("main:\n  mov r0, #3\nloop:\n  subs r0, r0, #1\n  bne loop\n");
+    vm::Predictors predictors({vm::Predictor::STATIC, vm::Predictor::BIMODAL});
+    predictors.reset(*image);
+
+    REQUIRE_FALSE( predictors.resolve(0, true, 1) );                // not a branch
+    REQUIRE_FALSE( predictors.resolve(2, true, 1) );                // backward and taken
+    REQUIRE_FALSE( predictors.resolve(2, true, 1) );
+    REQUIRE( predictors.resolve(2, false, 3) );                     // falls out of the loop
+
+    std::string report = predictors.report(*image);
+    REQUIRE( report.find("    static           3           1") != std::string::npos );
+    REQUIRE( report.find("   bimodal           3           2") != std::string::npos );
+}
@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../src/emulator/profiler.h"
+#include "assemble.h"
+
+// counts an instruction, then follows the branch it took, as tick does
+static void step(vm::Profiler& profiler, size_t index, size_t next) {
+    profiler.record(index, true);
+    if (next != index + 1) profiler.branch(index, next);
+}
+
+TEST_CASE( "Instructions, lines and labels are counted where the program spends its time", "[profiler]" ) {
+    auto image = assemble("main:\n  mov r0, #3\nloop:\n  subs r0, r0, #1\n  bne loop\n");
+    vm::Profiler profiler;
+    profiler.reset(*image, 0);
+
+    profiler.record(0, true);
+    for (int i = 3; i > 0; i--) {
+        profiler.record(1, true);
+        profiler.record(2, i > 1);                                  // the last bne falls through
+    }
+
+    REQUIRE( profiler.executed(1) == 3 );
+    REQUIRE( profiler.executed(2) == 2 );
+    REQUIRE( profiler.skipped(2) == 1 );
+
+    std::vector<uint64_t> lines = profiler.lines(*image);
+    REQUIRE( lines.size() == 6 );
+    REQUIRE( lines[2] == 1 );
+    REQUIRE( lines[4] == 3 );
+    REQUIRE( lines[5] == 3 );
+
+    std::string summary = profiler.report(vm::Profiler::SUMMARY, *image);
+    REQUIRE( summary.starts_with("7 cycles\n") );
+    REQUIRE( summary.find("(2 taken, 1 not taken)") != std::string::npos );
+    REQUIRE( summary.find("         6    85.7  loop\n") != std::string::npos );
+    REQUIRE( summary.find("         1    14.3  main\n") != std::string::npos );
+}
+
+TEST_CASE( "Sampled call stacks are folded into one line each", "[profiler]" ) {
+    auto image = assemble("main:\n  bl f\n  b end\nf:\n  bl g\n  bx lr\ng:\n  bx lr\nend:\n  mov r0, #0\n");
+    vm::Profiler profiler;
+    profiler.sample(1);
+    profiler.reset(*image, 0);
+
+    step(profiler, 0, 2);                                           // main calls f
+    step(profiler, 2, 4);                                           // which calls g
+    step(profiler, 4, 3);                                           // g returns
+    step(profiler, 3, 1);                                           // f returns
+    step(profiler, 1, 5);
+    step(profiler, 5, 6);
+
+    REQUIRE( profiler.report(vm::Profiler::FOLDED, *image) == "main 3\nmain;f 2\nmain;f;g 1\n" );
+    REQUIRE( profiler.executed(2) == 1 );
+    REQUIRE( profiler.skipped(2) == 0 );
+}
+
+TEST_CASE( "Runaway recursion is cut short in the folded stacks and the tree", "[profiler]" ) {
+    auto image = assemble("rec:\n  bl rec\n");
+    vm::Profiler profiler;
+    profiler.sample(1);
+    profiler.reset(*image, 0);
+    for (int i = 0; i < 1000; i++) step(profiler, 0, 0);
+
+    std::string folded = profiler.report(vm::Profiler::FOLDED, *image);
+    REQUIRE( std::count(folded.begin(), folded.end(), '\n') == 66 );          // every depth up to 64, then the rest
+    REQUIRE( folded.ends_with(";... 935\n") );
+
+    std::string tree = profiler.report(vm::Profiler::TREE, *image);
+    REQUIRE( std::count(tree.begin(), tree.end(), '\n') == 66 );
+    REQUIRE( tree.find("... deeper calls (935)") != std::string::npos );
+
+    std::string summary = profiler.report(vm::Profiler::SUMMARY, *image);
+    REQUIRE( summary.find("      1000   100.0      1000   100.0  rec") != std::string::npos );
+}
@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "../src/emulator/emulator.h"
+#include "../src/emulator/timing.h"
+#include "assemble.h"
+
+TEST_CASE( "A 3-stage pipeline charges taken branches for the refill", "[timing]" ) {
+    auto image = assemble("main:\n  mov r0, #1\n  b next\nnext:\n  addne r0, r0, r1, lsl r2\n  add r0, r0, r1, lsl r2\n");
+    auto pipeline = vm::TimingModel::pipeline(3);
+    pipeline->reset(*image);
+
+    pipeline->retire(0, true, false, false);
+    REQUIRE( pipeline->cycles() == 1 );
+    pipeline->retire(1, true, true, false);
+    REQUIRE( pipeline->cycles() == 4 );                             // 1 + 2 to refill
+    pipeline->retire(2, false, false, false);
+    REQUIRE( pipeline->cycles() == 5 );                             // skipped, so the shift costs nothing
+    pipeline->retire(3, true, false, false);
+    REQUIRE( pipeline->cycles() == 7 );                             // 1 + 1 to read the shift register
+}
+
+TEST_CASE( "Mispredictions only cost extra where the pipeline speculates", "[timing]" ) {
+    auto image = assemble("loop:\n  bne loop\n");
+
+    auto three = vm::TimingModel::pipeline(3);
+    three->reset(*image);
+    three->retire(0, true, true, true);
+    REQUIRE( three->cycles() == 3 );
+
+    auto five = vm::TimingModel::pipeline(5);
+    five->reset(*image);
+    five->retire(0, true, true, true);
+    REQUIRE( five->cycles() == 4 );
+    five->retire(0, false, false, true);
+    REQUIRE( five->cycles() == 6 );
+}
+
+TEST_CASE( "Only 3 and 5 stage pipelines are modelled", "[timing]" ) {
+    REQUIRE_THROWS_AS( vm::TimingModel::pipeline(4), std::invalid_argument );
+}
+
+// the wall clock time of the quickest of a few runs of a program, waiting for each to finish
+static std::chrono::duration<double> fastest(vm::Emulator& emulator, const std::string& program, uint64_t steps) {
+    std::chrono::duration<double> best = std::chrono::hours(1);
+    for (int run = 0; run < 3; run++) {
+        emulator.reset();                                           // so that the last run's steps aren't mistaken for this one's
+        auto start = std::chrono::steady_clock::now();
+        emulator.run(program);
+        while (emulator.snapshot().steps != steps || emulator.snapshot().running) {
+            REQUIRE( std::chrono::steady_clock::now() - start < std::chrono::seconds(60) );
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        best = std::min<std::chrono::duration<double>>(best, std::chrono::steady_clock::now() - start);
+    }
+    return best;
+}
+
+// hidden from the default run since it depends on the wall clock; run it on a quiet machine with [performance]
+TEST_CASE( "Estimating cycles at most doubles the time a program takes to run", "[.][timing][performance]" ) {
+    const std::string program = "main:\n  mov r1, #0x10000\nloop:\n  subs r1, r1, #1\n  bne loop\n";
+    const uint64_t steps = 1 + 2 * 0x10000;
+
+    vm::Emulator emulator;
+    emulator.stepDelay(0);
+
+    auto untimed = fastest(emulator, program, steps);
+    emulator.time(3);
+    auto timed = fastest(emulator, program, steps);
+    REQUIRE( emulator.snapshot().cycles > steps );
+    emulator.shutdown();
+
+    INFO( "untimed " << untimed.count() << "s, timed " << timed.count() << "s" );
+    REQUIRE( timed < 2 * untimed );
+}
@@ -0,0 +1,83 @@
+#include <catch2/catch_all.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "../src/emulator/assembler.h"
+#include "../src/emulator/trace.h"
+#include "../src/emulator/windows/memory.h"
+
+static std::vector<uint32_t> pcs(const std::vector<vm::Record>& records) {
+    std::vector<uint32_t> pcs;
+    for (const vm::Record& record : records) pcs.push_back(record.pc);
+    return pcs;
+}
+
+TEST_CASE( "A ring buffer trace keeps the most recent records", "[trace]" ) {
+    vm::Trace trace(4);
+    REQUIRE( trace.recent(10).empty() );
+
+    for (uint32_t i = 0; i < 3; i++) trace.append({ .pc = i });
+    REQUIRE( pcs(trace.recent(10)) == std::vector<uint32_t>{0, 1, 2} );
+
+    for (uint32_t i = 3; i < 10; i++) trace.append({ .pc = i });
+    REQUIRE( trace.size() == 10 );
+    REQUIRE_FALSE( trace.toFile() );
+    REQUIRE( pcs(trace.recent(10)) == std::vector<uint32_t>{6, 7, 8, 9} );
+    REQUIRE( pcs(trace.recent(2)) == std::vector<uint32_t>{8, 9} );
+}
+
+TEST_CASE( "A file trace is a header followed by every record", "[trace]" ) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "irisc-test.trace";
+    {
+        vm::Trace trace(path.string());
+        for (uint32_t i = 0; i < 5; i++) trace.append({ .pc = i * 32, .word = 0xe3a00000 | i, .reg = 0, .flags = vm::Record::EXECUTED });
+        REQUIRE( trace.toFile() );
+        REQUIRE( pcs(trace.recent(2)) == std::vector<uint32_t>{96, 128} );
+    }
+
+    REQUIRE( std::filesystem::file_size(path) == 6 * sizeof(vm::Record) );
+
+    std::ifstream file(path, std::ios::binary);
+    vm::Header header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    REQUIRE( std::memcmp(header.magic, vm::Header().magic, sizeof(header.magic)) == 0 );
+    REQUIRE( header.recordSize == sizeof(vm::Record) );
+
+    std::vector<vm::Record> records(5);
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(vm::Record));
+    REQUIRE( pcs(records) == std::vector<uint32_t>{0, 32, 64, 96, 128} );
+    REQUIRE( records[4].word == 0xe3a00004 );
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Saved ring buffers can be read back like file traces", "[trace]" ) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "irisc-test-ring.trace";
+    vm::Trace trace(2);
+    for (uint32_t i = 0; i < 3; i++) trace.append({ .pc = i });
+    vm::Trace::save(path.string(), trace.recent(2));
+
+    REQUIRE( std::filesystem::file_size(path) == 3 * sizeof(vm::Record) );
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Records are printed with what they wrote", "[trace]" ) {
+    vm::Record written { .pc = 0x40, .word = 0xe2800001, .value = 7, .reg = 0, .flags = vm::Record::EXECUTED | 0x40 };
+    REQUIRE( vm::Trace::format(written, 3) == "         3  00000040  e2800001  r0  0x00000007  nzcv 0100" );
+
+    vm::Record skipped { .pc = 0x60, .word = 0x12800001 };
+    REQUIRE( vm::Trace::format(skipped, 4).find("skipped") != std::string::npos );
+}
+
+TEST_CASE( "Branches and shifts are traced with their machine code", "[trace]" ) {
+    vm::Memory memory;
+    memory.softReset();
+    vm::Assembler assembler(memory);
+    assembler.assemble("main:\n  mov r0, #1\n  lsl r1, r0, #2\n  asrs r2, r1, r0\n  bl f\n  b main\nf:\n  bx lr\n");
+    memory.predecode();
+
+    std::vector<uint32_t> words;
+    for (size_t i = 0; i < 6; i++) words.push_back(memory.word(memory.memstart() + i * 32));
+    REQUIRE( words == std::vector<uint32_t> {0xe3a00001, 0xe1a01100, 0xe1b02051, 0xeb000000, 0xeafffffa, 0xe12fff1e} );
+}
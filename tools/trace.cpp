@@ -0,0 +1,94 @@
+/**
+ * @file trace.cpp
+ * Reads back a trace written by ':trace', printing the records which match every filter given.
+ *
+ *   irisc-trace trace.bin [--pc address] [--reg n] [--from step] [--to step] [--skipped] [--limit n] [--count]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <cstring>
+#include <vector>
+
+#include "../src/emulator/trace.h"
+
+namespace {
+    struct Filter {
+        std::optional<uint32_t> pc;
+        std::optional<uint8_t> reg;
+        uint64_t from = 1;
+        uint64_t to = UINT64_MAX;
+        bool skipped = false;                                   // only instructions whose condition failed
+        uint64_t limit = UINT64_MAX;
+        bool count = false;                                     // print how many match instead of the records
+
+        bool matches(const vm::Record& record) const {
+            if (pc && record.pc != *pc) return false;
+            if (reg && record.reg != *reg) return false;
+            return !skipped || !(record.flags & vm::Record::EXECUTED);
+        }
+    };
+
+    int usage() {
+        std::cerr << "Usage: irisc-trace file [--pc address] [--reg n] [--from step] [--to step] [--skipped] [--limit n] [--count]" << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) return usage();
+
+    Filter filter;
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string option = argv[i];
+            if (option == "--skipped") filter.skipped = true;
+            else if (option == "--count") filter.count = true;
+            else if (i + 1 == argc) return usage();
+            else if (option == "--pc") filter.pc = std::stoul(argv[++i], nullptr, 0);
+            else if (option == "--reg") {
+                std::string reg = argv[++i];
+                filter.reg = std::stoul(reg[0] == 'r' ? reg.substr(1) : reg);
+            }
+            else if (option == "--from") filter.from = std::stoull(argv[++i]);
+            else if (option == "--to") filter.to = std::stoull(argv[++i]);
+            else if (option == "--limit") filter.limit = std::stoull(argv[++i]);
+            else return usage();
+        }
+    }
+    catch (const std::logic_error&) {
+        return usage();
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    vm::Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        std::cerr << "Could not read '" << argv[1] << "'." << std::endl;
+        return 1;
+    }
+    if (std::memcmp(header.magic, vm::Header().magic, sizeof(header.magic)) || header.recordSize != sizeof(vm::Record)) {
+        std::cerr << "'" << argv[1] << "' is not an iRISC trace." << std::endl;
+        return 1;
+    }
+
+    // records are read a block at a time, so that traces far bigger than memory can be filtered
+    std::vector<vm::Record> block(4096);
+    uint64_t step = 0;
+    uint64_t matched = 0;
+    while (step < filter.to && matched < filter.limit) {
+        file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(vm::Record));
+        size_t read = file.gcount() / sizeof(vm::Record);
+        if (read == 0) break;
+
+        for (size_t i = 0; i < read && step < filter.to && matched < filter.limit; i++) {
+            if (++step < filter.from || !filter.matches(block[i])) continue;
+            matched++;
+            if (!filter.count) std::cout << vm::Trace::format(block[i], step) << '\n';
+        }
+    }
+
+    if (filter.count) std::cout << matched << '\n';
+    return 0;
+}